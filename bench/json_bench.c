@@ -0,0 +1,1792 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "json_parser.h"
+#include "json_simd.h"
+#include "json_writer.h"
+#include "json_stream.h"
+#include "json_push.h"
+#include "json_ndjson.h"
+#include "json_cursor.h"
+#include "json_path.h"
+#include "json_bind.h"
+#include "json_keys.h"
+#include "json_bin.h"
+#include "json_cache.h"
+#include "json_doc.h"
+
+
+struct bench_buf_t {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+
+static void
+bench_buf_append(struct bench_buf_t *b, const char *s, size_t n)
+{
+    if (b->len + n > b->cap) {
+        while (b->len + n > b->cap) {
+            b->cap = b->cap ? b->cap * 2 : 4096;
+        }
+
+        b->data = realloc(b->data, b->cap);
+    }
+
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+
+static void
+bench_gen_records(struct bench_buf_t *b, size_t size)
+{
+    char tmp[256];
+    size_t i = 0;
+
+    bench_buf_append(b, "[\n", 2);
+
+    while (b->len < size) {
+        int n = snprintf(tmp, sizeof tmp,
+                         "%s    {\n"
+                         "        \"id\": %zu,\n"
+                         "        \"name\": \"record-%zu\",\n"
+                         "        \"tags\": [\"alpha\", \"beta\", \"gamma\"],\n"
+                         "        \"active\": %s,\n"
+                         "        \"parent\": null,\n"
+                         "        \"note\": \"quoted \\\"text\\\" with\\tescapes\"\n"
+                         "    }",
+                         i ? ",\n" : "", i, i, (i & 1) ? "true" : "false");
+
+        bench_buf_append(b, tmp, (size_t)n);
+        ++i;
+    }
+
+    bench_buf_append(b, "\n]\n", 3);
+}
+
+
+static void
+bench_gen_strings(struct bench_buf_t *b, size_t size)
+{
+    char text[1024];
+    size_t i = 0;
+
+    for (size_t j = 0; j < sizeof text - 1; ++j) {
+        text[j] = 'a' + (char)(j % 26);
+    }
+    text[sizeof text - 1] = 0;
+
+    bench_buf_append(b, "[", 1);
+
+    while (b->len < size) {
+        char tmp[sizeof text + 64];
+        int n = snprintf(tmp, sizeof tmp, "%s\"%.*s\"", i ? ", " : "",
+                         (int)(64 + (i * 131) % (sizeof text - 64)), text);
+
+        bench_buf_append(b, tmp, (size_t)n);
+        ++i;
+    }
+
+    bench_buf_append(b, "]", 1);
+}
+
+
+static void
+bench_gen_numbers(struct bench_buf_t *b, size_t size)
+{
+    char tmp[128];
+    size_t i = 0;
+
+    /* canada.json-like: polygons of [lon, lat] pairs with ~15 significant digits */
+    static const char head[] = "{\"type\":\"Polygon\",\"coordinates\":[[";
+
+    bench_buf_append(b, head, sizeof head - 1);
+
+    while (b->len < size) {
+        double lon = -141.0 + (double)((i * 2654435761u) % 8000000) / 100000.0;
+        double lat = 41.0 + (double)((i * 40503u) % 4200000) / 100000.0 + 1e-12 * (i % 997);
+
+        int n = snprintf(tmp, sizeof tmp, "%s[%.15g,%.15g]", i ? "," : "", lon, lat);
+
+        bench_buf_append(b, tmp, (size_t)n);
+        ++i;
+    }
+
+    bench_buf_append(b, "]]}", 3);
+}
+
+
+static void
+bench_gen_lines(struct bench_buf_t *b, size_t size)
+{
+    char tmp[256];
+    size_t i = 0;
+
+    while (b->len < size) {
+        int n = snprintf(tmp, sizeof tmp,
+                         "{\"ts\":%zu,\"level\":\"%s\",\"msg\":\"request %zu served\",\"latency\":%.3f,"
+                         "\"tags\":[\"api\",\"v2\"],\"user\":{\"id\":%zu,\"admin\":%s}}\n",
+                         1700000000000 + i, (i % 7) ? "info" : "warn", i, (double)(i % 1000) / 7.0,
+                         i % 10007, (i & 1) ? "true" : "false");
+
+        bench_buf_append(b, tmp, (size_t)n);
+        ++i;
+    }
+}
+
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static int bench_on_null(void *ctx) { return 0; }
+static int bench_on_bool(void *ctx, int b) { return 0; }
+static int bench_on_int(void *ctx, int i) { return 0; }
+static int bench_on_uint(void *ctx, unsigned int i) { return 0; }
+static int bench_on_int64(void *ctx, int64_t i) { return 0; }
+static int bench_on_uint64(void *ctx, uint64_t i) { return 0; }
+static int bench_on_double(void *ctx, double d) { return 0; }
+static int bench_on_string(void *ctx, const char *str, size_t len) { return 0; }
+static int bench_on_start(void *ctx) { return 0; }
+static int bench_on_end(void *ctx, size_t count) { return 0; }
+
+
+static struct json_parser_handler_vtbl_t
+bench_null_handler_vtbl = {
+    &bench_on_null,
+    &bench_on_bool,
+    &bench_on_int,
+    &bench_on_uint,
+    &bench_on_int64,
+    &bench_on_uint64,
+    &bench_on_double,
+    &bench_on_string,
+    &bench_on_string,
+    &bench_on_start,
+    &bench_on_end,
+    &bench_on_start,
+    &bench_on_end
+};
+
+
+static double
+bench_read_str(const char *str, size_t len, int iterations)
+{
+    struct json_parser_handler_t h;
+    h.vtbl = &bench_null_handler_vtbl;
+    h.ctx = NULL;
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_read_str(str, len, &h)) {
+            fprintf(stderr, "json_read_str failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+#define BENCH_CHUNK_SIZE    4096
+
+
+static int
+bench_feed(struct json_push_parser_t *p, const char *str, size_t len)
+{
+    for (size_t i = 0; i < len; i += BENCH_CHUNK_SIZE) {
+        if (json_feed(p, str + i, (len - i < BENCH_CHUNK_SIZE) ? len - i : BENCH_CHUNK_SIZE)) {
+            return -1;
+        }
+    }
+
+    return json_finish(p);
+}
+
+
+static double
+bench_push(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    struct json_parser_handler_t h;
+    h.vtbl = &bench_null_handler_vtbl;
+    h.ctx = NULL;
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        struct json_push_parser_t p;
+
+        if (parser) {
+            json_push_parser_dom(&p, parser);
+        }
+        else {
+            json_push_parser_init(&p, &h);
+        }
+
+        int r = bench_feed(&p, str, len);
+        json_push_parser_free(&p);
+
+        if (r) {
+            fprintf(stderr, "json_feed failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+static void *
+bench_on_alloc(void *ctx, size_t size)
+{
+    return malloc(size);
+}
+
+
+static void
+bench_on_free(void *ctx, void *p)
+{
+    free(p);
+}
+
+
+static struct json_allocator_vtbl_t
+bench_malloc_allocator_vtbl = {
+    &bench_on_alloc,
+    &bench_on_free,
+    NULL
+};
+
+
+static double
+bench_parse_stream(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        struct json_str_stream_ctx_t ctx;
+        struct json_stream_t stream;
+        json_str_stream_init(&stream, &ctx, str, len);
+
+        if (json_parse_stream(parser, &stream)) {
+            fprintf(stderr, "json_parse_stream failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+static double
+bench_parse_str(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_parse_str(parser, str, len)) {
+            fprintf(stderr, "json_parse_str failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+static double
+bench_utf8_validate(const char *str, size_t len, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_utf8_validate(str, len)) {
+            fprintf(stderr, "json_utf8_validate failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+static double
+bench_object_lookup(const struct json_value_t *obj, char (*keys)[32], size_t count,
+                    size_t lookups, int use_index)
+{
+    size_t found = 0;
+    double begin = bench_now();
+
+    for (size_t n = 0; n < lookups; ++n) {
+        const char *key = keys[(n * 7) % count];
+        size_t len = strlen(key);
+
+        if (use_index) {
+            found += !!json_object_get(obj, key, len);
+            continue;
+        }
+
+        for (size_t i = 0; i < json_object_size(obj); ++i) {
+            if (json_string_equal(&json_object_at(obj, i)->key, key, len)) {
+                ++found;
+                break;
+            }
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    if (found != lookups) {
+        fprintf(stderr, "object lookup failed\n");
+        exit(1);
+    }
+
+    return seconds;
+}
+
+
+static void
+bench_objects(struct json_parser_t *parser)
+{
+    static const size_t sizes[] = { 4, 16, 64, 256, 1024, 4096 };
+    const size_t lookups = 4 * 1000 * 1000;
+
+    printf("objects: ns per lookup (scan / json_object_get)\n");
+
+    for (size_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s) {
+        struct bench_buf_t doc = { 0 };
+        char (*keys)[32] = malloc(sizes[s] * sizeof *keys);
+        char tmp[64];
+
+        bench_buf_append(&doc, "{", 1);
+
+        for (size_t i = 0; i < sizes[s]; ++i) {
+            snprintf(keys[i], sizeof keys[i], "field_%zu", i);
+            int n = snprintf(tmp, sizeof tmp, "%s\"%s\": %zu", i ? ", " : "", keys[i], i);
+            bench_buf_append(&doc, tmp, (size_t)n);
+        }
+
+        bench_buf_append(&doc, "}", 1);
+
+        if (json_parse_str(parser, doc.data, doc.len)) {
+            fprintf(stderr, "json_parse_str failed\n");
+            exit(1);
+        }
+
+        double scan = bench_object_lookup(parser->root, keys, sizes[s], lookups, 0);
+        double get = bench_object_lookup(parser->root, keys, sizes[s], lookups, 1);
+
+        printf("%-24zu %10.1f %10.1f\n", sizes[s], scan * 1e9 / lookups, get * 1e9 / lookups);
+
+        free(keys);
+        free(doc.data);
+    }
+}
+
+
+static void
+bench_save(char *path, const char *str, size_t len)
+{
+    int fd = mkstemp(path);
+
+    if ((fd < 0) || (write(fd, str, len) != (ssize_t)len)) {
+        fprintf(stderr, "mkstemp failed\n");
+        exit(1);
+    }
+
+    close(fd);
+}
+
+
+static double
+bench_parse_fd(struct json_parser_t *parser, const char *path, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        int fd = open(path, O_RDONLY);
+
+        if ((fd < 0) || json_parse_fd(parser, fd)) {
+            fprintf(stderr, "json_parse_fd failed\n");
+            exit(1);
+        }
+
+        close(fd);
+    }
+
+    return bench_now() - begin;
+}
+
+
+static double
+bench_parse_file(struct json_parser_t *parser, const char *path, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_parse_file(parser, path)) {
+            fprintf(stderr, "json_parse_file failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+/* the document as a binary image, saved to path; its size */
+static size_t
+bench_bin_save(struct json_parser_t *parser, const char *str, size_t len, char *path)
+{
+    char *data;
+    size_t size;
+
+    if (json_parse_str(parser, str, len) || json_bin_encode(parser->root, &data, &size)) {
+        fprintf(stderr, "json_bin_encode failed\n");
+        exit(1);
+    }
+
+    bench_save(path, data, size);
+    free(data);
+
+    return size;
+}
+
+
+static double
+bench_bin_encode(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    char *data;
+    size_t size;
+
+    if (json_parse_str(parser, str, len)) {
+        fprintf(stderr, "json_parse_str failed\n");
+        exit(1);
+    }
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_bin_encode(parser->root, &data, &size)) {
+            fprintf(stderr, "json_bin_encode failed\n");
+            exit(1);
+        }
+
+        free(data);
+    }
+
+    return bench_now() - begin;
+}
+
+
+/* what a process start costs with the image: map it and look at the root */
+static double
+bench_bin_mmap(const char *path, int iterations)
+{
+    struct json_bin_t b;
+    struct stat st;
+    size_t members = 0;
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        int fd = open(path, O_RDONLY);
+
+        if ((fd < 0) || fstat(fd, &st)) {
+            fprintf(stderr, "open failed\n");
+            exit(1);
+        }
+
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if ((MAP_FAILED == data) || json_bin_open(&b, data, st.st_size)) {
+            fprintf(stderr, "json_bin_open failed\n");
+            exit(1);
+        }
+
+        members += json_bin_size(&b, json_bin_root(&b));
+
+        munmap(data, st.st_size);
+        close(fd);
+    }
+
+    double seconds = bench_now() - begin;
+
+    if (!members) {
+        fprintf(stderr, "json_bin_open read nothing\n");
+    }
+
+    return seconds;
+}
+
+
+static double
+bench_bin_decode(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    struct json_arena_t arena;
+    struct json_allocator_t a;
+    struct json_bin_t b;
+    char *data;
+    size_t size;
+
+    if (json_parse_str(parser, str, len) || json_bin_encode(parser->root, &data, &size)
+        || json_bin_open(&b, data, size)) {
+        fprintf(stderr, "json_bin_encode failed\n");
+        exit(1);
+    }
+
+    json_arena_init(&arena, 0);
+    json_arena_allocator(&a, &arena);
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        json_arena_rewind(&arena);
+
+        if (!json_bin_decode(&a, &b, json_bin_root(&b))) {
+            fprintf(stderr, "json_bin_decode failed\n");
+            exit(1);
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    json_arena_release(&arena);
+    free(data);
+
+    return seconds;
+}
+
+
+static double
+bench_parse_parallel(struct json_parser_t *parser, const char *str, size_t len, int iterations, unsigned threads)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_parse_str_parallel(parser, str, len, threads)) {
+            fprintf(stderr, "json_parse_str_parallel failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+/* the selective read cursors are for: two fields out of every record */
+static double
+bench_cursor(const char *str, size_t len, int iterations)
+{
+    double begin = bench_now();
+    int64_t sum = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        struct json_cursor_t c;
+        json_cursor_init(&c, str, len);
+
+        json_cursor_enter(&c);
+
+        while (json_cursor_next(&c, NULL)) {
+            struct json_string_t key;
+            struct json_string_t name;
+            int64_t id;
+
+            json_cursor_enter(&c);
+
+            while (json_cursor_next(&c, &key)) {
+                if (json_string_equal(&key, "id", 2)) {
+                    json_cursor_get_int64(&c, &id);
+                    sum += id;
+                }
+                else if (json_string_equal(&key, "name", 4)) {
+                    json_cursor_get_string(&c, &name);
+                    sum += name.len;
+                    json_cursor_leave(&c);
+                    break;
+                }
+            }
+        }
+
+        if (c.error) {
+            fprintf(stderr, "json_cursor failed\n");
+            exit(1);
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    if (!sum) {
+        fprintf(stderr, "json_cursor read nothing\n");
+    }
+
+    return seconds;
+}
+
+
+static double
+bench_write(struct json_parser_t *parser, const char *str, size_t len, int iterations, int flags)
+{
+    struct json_buf_stream_ctx_t ctx;
+    struct json_stream_t stream;
+    json_buf_stream_init(&stream, &ctx);
+
+    if (json_parse_str(parser, str, len)) {
+        fprintf(stderr, "json_parse_str failed\n");
+        exit(1);
+    }
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        ctx.len = 0;
+
+        if (json_write(&stream, parser->root, flags)) {
+            fprintf(stderr, "json_write failed\n");
+            exit(1);
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    free(ctx.data);
+
+    return seconds;
+}
+
+
+static double
+bench_read_write(const char *str, size_t len, int iterations)
+{
+    struct json_buf_stream_ctx_t ctx;
+    struct json_stream_t stream;
+    json_buf_stream_init(&stream, &ctx);
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        struct json_writer_t w;
+        struct json_parser_handler_t h;
+
+        ctx.len = 0;
+        json_writer_init(&w, &stream, 0);
+        json_writer_handler(&h, &w);
+
+        if (json_read_str(str, len, &h) || json_writer_flush(&w)) {
+            fprintf(stderr, "json_read_str -> json_writer failed\n");
+            exit(1);
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    free(ctx.data);
+
+    return seconds;
+}
+
+
+static int
+bench_on_record(void *ctx, const struct json_ndjson_record_t *record)
+{
+    return record->error;
+}
+
+
+static double
+bench_ndjson(const char *str, size_t len, int iterations, unsigned threads)
+{
+    struct json_ndjson_handler_t h = { &bench_on_record, NULL };
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        if (json_parse_ndjson(str, len, threads, JSON_NDJSON_ORDERED, 64, &h)) {
+            fprintf(stderr, "json_parse_ndjson failed\n");
+            exit(1);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+/* what callers did before json_parse_ndjson: split lines, one parser, one thread */
+static double
+bench_lines(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        const char *p = str;
+        const char *end = str + len;
+
+        while (p < end) {
+            const char *nl = memchr(p, '\n', end - p);
+            const char *line_end = nl ? nl : end;
+
+            if (json_parse_str(parser, p, line_end - p)) {
+                fprintf(stderr, "json_parse_str failed\n");
+                exit(1);
+            }
+
+            p = line_end + 1;
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+static int
+bench_on_match(void *ctx, size_t path)
+{
+    ++*(size_t *)ctx;
+    return 0;
+}
+
+
+/* a router pulling two fields out of every message */
+/* bench_lines keeping every line as a document of its own for a moment */
+static double
+bench_freeze_lines(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        const char *p = str;
+        const char *end = str + len;
+
+        while (p < end) {
+            const char *nl = memchr(p, '\n', end - p);
+            const char *line_end = nl ? nl : end;
+            struct json_doc_t *doc;
+
+            if (json_parse_str(parser, p, line_end - p) || !(doc = json_doc_freeze(parser))) {
+                fprintf(stderr, "json_doc_freeze failed\n");
+                exit(1);
+            }
+
+            json_doc_release(doc);
+
+            p = line_end + 1;
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+/* bench_lines with every line through the cache */
+static double
+bench_cache_lines(struct json_cache_t *cache, struct json_parser_t *parser, const char *str, size_t len,
+                  int iterations)
+{
+    struct json_cache_doc_t *doc;
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        const char *p = str;
+        const char *end = str + len;
+
+        while (p < end) {
+            const char *nl = memchr(p, '\n', end - p);
+            const char *line_end = nl ? nl : end;
+
+            if (json_cache_parse(cache, parser, p, line_end - p, &doc)) {
+                fprintf(stderr, "json_cache_parse failed\n");
+                exit(1);
+            }
+
+            json_cache_release(cache, doc);
+
+            p = line_end + 1;
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+
+static double
+bench_path_lines(const char *str, size_t len, int iterations)
+{
+    const char *paths[2] = { "/level", "/user/id" };
+    struct json_parser_handler_t h = { &bench_null_handler_vtbl, NULL };
+    size_t matches = 0;
+    struct json_path_handler_t ph = { &bench_on_match, &matches, &h };
+    struct json_path_t path;
+
+    if (json_path_compile(&path, paths, 2)) {
+        fprintf(stderr, "json_path_compile failed\n");
+        exit(1);
+    }
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        const char *p = str;
+        const char *end = str + len;
+
+        while (p < end) {
+            const char *nl = memchr(p, '\n', end - p);
+            const char *line_end = nl ? nl : end;
+
+            if (json_read_path_str(p, line_end - p, &path, &ph)) {
+                fprintf(stderr, "json_read_path_str failed\n");
+                exit(1);
+            }
+
+            p = line_end + 1;
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    json_path_free(&path);
+
+    if (!matches) {
+        fprintf(stderr, "json_read_path_str matched nothing\n");
+    }
+
+    return seconds;
+}
+
+
+struct bench_user_t {
+    int64_t id;
+    int admin;
+};
+
+
+struct bench_message_t {
+    int64_t ts;
+    struct json_string_t level;
+    struct json_string_t msg;
+    double latency;
+    struct json_string_t tags[4];
+    size_t tags_count;
+    struct bench_user_t user;
+};
+
+
+static struct json_bind_field_t
+bench_user_fields[] = {
+    JSON_BIND_FIELD(struct bench_user_t, id, INT64),
+    JSON_BIND_FIELD(struct bench_user_t, admin, BOOL)
+};
+
+static struct json_bind_t
+bench_user_bind = JSON_BIND(struct bench_user_t, bench_user_fields);
+
+
+static struct json_bind_field_t
+bench_message_fields[] = {
+    JSON_BIND_FIELD(struct bench_message_t, ts, INT64),
+    JSON_BIND_FIELD(struct bench_message_t, level, STRING),
+    JSON_BIND_FIELD(struct bench_message_t, msg, STRING),
+    JSON_BIND_FIELD(struct bench_message_t, latency, DOUBLE),
+    JSON_BIND_ARRAY(struct bench_message_t, tags, STRING, tags_count),
+    JSON_BIND_OBJECT(struct bench_message_t, user, bench_user_bind)
+};
+
+static struct json_bind_t
+bench_message_bind = JSON_BIND(struct bench_message_t, bench_message_fields);
+
+
+static int64_t
+bench_get_int64(const struct json_value_t *v)
+{
+    if (!v) {
+        return 0;
+    }
+
+    return (JSON_VALUE_TYPE_INT == v->type) ? v->i : (JSON_VALUE_TYPE_INT64 == v->type) ? v->i64 : 0;
+}
+
+
+/* what a handler for a hot message type does today */
+static void
+bench_message_copy(const struct json_value_t *root, struct bench_message_t *m)
+{
+    const struct json_value_t *v;
+
+    memset(m, 0, sizeof *m);
+
+    m->ts = bench_get_int64(json_object_get(root, "ts", 2));
+
+    if ((v = json_object_get(root, "level", 5)) && (JSON_VALUE_TYPE_STRING == v->type)) {
+        m->level = v->str;
+    }
+
+    if ((v = json_object_get(root, "msg", 3)) && (JSON_VALUE_TYPE_STRING == v->type)) {
+        m->msg = v->str;
+    }
+
+    if ((v = json_object_get(root, "latency", 7)) && (JSON_VALUE_TYPE_DOUBLE == v->type)) {
+        m->latency = v->d;
+    }
+
+    if ((v = json_object_get(root, "tags", 4)) && (JSON_VALUE_TYPE_ARRAY == v->type)) {
+        for (size_t i = 0; (i < json_array_size(v)) && (i < 4); ++i) {
+            m->tags[m->tags_count++] = json_array_get(v, i)->str;
+        }
+    }
+
+    if ((v = json_object_get(root, "user", 4)) && (JSON_VALUE_TYPE_OBJECT == v->type)) {
+        const struct json_value_t *admin = json_object_get(v, "admin", 5);
+
+        m->user.id = bench_get_int64(json_object_get(v, "id", 2));
+        m->user.admin = admin && (JSON_VALUE_TYPE_BOOL == admin->type) && admin->b;
+    }
+}
+
+
+static double
+bench_messages(struct json_parser_t *parser, const char *str, size_t len, int iterations)
+{
+    struct bench_message_t m;
+    int64_t sum = 0;
+
+    json_bind_prepare(&bench_message_bind);
+
+    double begin = bench_now();
+
+    for (int i = 0; i < iterations; ++i) {
+        const char *p = str;
+        const char *end = str + len;
+
+        while (p < end) {
+            const char *nl = memchr(p, '\n', end - p);
+            const char *line_end = nl ? nl : end;
+
+            if (parser) {
+                if (json_parse_str(parser, p, line_end - p)) {
+                    fprintf(stderr, "json_parse_str failed\n");
+                    exit(1);
+                }
+
+                bench_message_copy(parser->root, &m);
+            }
+            else if (json_bind_str(p, line_end - p, &bench_message_bind, &m)) {
+                fprintf(stderr, "json_bind_str failed\n");
+                exit(1);
+            }
+
+            sum += m.user.id + m.tags_count;
+            p = line_end + 1;
+        }
+    }
+
+    double seconds = bench_now() - begin;
+
+    if (!sum) {
+        fprintf(stderr, "messages read nothing\n");
+    }
+
+    return seconds;
+}
+
+
+static void
+bench_report(const char *name, size_t len, int iterations, double seconds)
+{
+    printf("%-24s %10.1f MB/s\n", name, (double)len * iterations / seconds / (1024 * 1024));
+}
+
+
+/* the corpus suite: json_bench --suite [--reps=N] [--warmup=N] [--scale=N] [--format=json] [--corpus=DIR] */
+
+#define BENCH_SUITE_DEPTH           1024
+#define BENCH_SUITE_DOCS            16
+
+
+struct bench_doc_t {
+    char name[64];
+    struct bench_buf_t buf;
+};
+
+
+struct bench_suite_t {
+    int warmup;
+    int reps;
+    int json;
+
+    struct json_parser_t parser;
+    struct json_parser_t malloc_parser;
+    struct json_allocator_t malloc_allocator;
+
+    struct json_buf_stream_ctx_t out;
+    struct json_stream_t out_stream;
+
+    double *samples;
+};
+
+
+struct bench_op_t {
+    const char *name;
+    int(*prepare)(struct bench_suite_t *s, const char *str, size_t len);
+    int(*run)(struct bench_suite_t *s, const char *str, size_t len);
+};
+
+
+static void
+bench_appendf(struct bench_buf_t *b, const char *fmt, ...)
+{
+    char tmp[1024];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof tmp, fmt, ap);
+    va_end(ap);
+
+    bench_buf_append(b, tmp, (size_t)n);
+}
+
+
+/* international text: raw UTF-8 in several scripts and \u escapes, surrogate pairs among them */
+static void
+bench_gen_unicode(struct bench_buf_t *b, size_t size)
+{
+    static const char *texts[] = {
+        "Gr\xc3\xbc\xc3\x9f" "e aus M\xc3\xbcnchen, \xc3\xa7" "a va tr\xc3\xa8s bien",
+        "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\x86\xe3\x82\xad\xe3\x82\xb9\xe3\x83\x88",
+        "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, \xd0\xbc\xd0\xb8\xd1\x80",
+        "\\u00e9t\\u00e9 \\u20ac42 \\ud83d\\ude00 \\u4e2d\\u6587",
+        "emoji \xf0\x9f\x8e\x89\xf0\x9f\x9a\x80 and plain ASCII to pad the run out a bit"
+    };
+    size_t i = 0;
+
+    bench_buf_append(b, "[", 1);
+
+    while (b->len < size) {
+        bench_appendf(b, "%s{\"id\":%zu,\"lang\":\"%s\",\"text\":\"%s\",\"note\":\"%s\"}",
+                      i ? "," : "", i, (i % 5 == 1) ? "ja" : "de", texts[i % 5], texts[(i + 3) % 5]);
+        ++i;
+    }
+
+    bench_buf_append(b, "]", 1);
+}
+
+
+/* twitter.json-like: search results, statuses with a nested user and entities */
+static void
+bench_gen_twitter(struct bench_buf_t *b, size_t size)
+{
+    static const char *langs[] = { "ja", "en", "es", "pt" };
+    size_t i = 0;
+
+    bench_appendf(b, "{\"statuses\":[");
+
+    while (b->len < size) {
+        uint64_t id = 505874924095815681ull + i * 7919;
+        const char *lang = langs[i % 4];
+
+        bench_appendf(b,
+            "%s{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"%s\"},"
+            "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":%llu,\"id_str\":\"%llu\","
+            "\"text\":\"@aym0566x \\n\\nname:Tweet %zu\\nfavorite: \\\"music\\\" and more\\n#tag%zu\","
+            "\"source\":\"<a href=\\\"http:\\/\\/twitter.com\\/download\\/iphone\\\" rel=\\\"nofollow\\\">"
+            "Twitter for iPhone<\\/a>\",\"truncated\":false,\"in_reply_to_status_id\":null,"
+            "\"in_reply_to_user_id\":%zu,\"in_reply_to_screen_name\":\"user%zu\",",
+            i ? "," : "", lang, (unsigned long long)id, (unsigned long long)id, i, i % 97,
+            (i * 31) % 1000003, i % 5000);
+
+        bench_appendf(b,
+            "\"user\":{\"id\":%zu,\"id_str\":\"%zu\",\"name\":\"User %zu\",\"screen_name\":\"user%zu\","
+            "\"location\":\"Somewhere %zu\",\"description\":\"bio of user %zu \\/ likes \\\"json\\\"\","
+            "\"url\":null,\"entities\":{\"description\":{\"urls\":[]}},\"protected\":false,"
+            "\"followers_count\":%zu,\"friends_count\":%zu,\"listed_count\":%zu,"
+            "\"created_at\":\"Thu Jul 04 09:20:14 +0000 2013\",\"favourites_count\":%zu,"
+            "\"utc_offset\":null,\"time_zone\":null,\"geo_enabled\":%s,\"verified\":false,"
+            "\"statuses_count\":%zu,\"lang\":\"%s\",\"profile_background_color\":\"C0DEED\","
+            "\"profile_image_url\":\"http:\\/\\/pbs.twimg.com\\/profile_images\\/%zu\\/normal.jpeg\","
+            "\"default_profile\":true,\"following\":false,\"notifications\":false},",
+            i * 13, i * 13, i, i, i % 50, i, i * 3 % 9000, i * 7 % 3000, i % 40, i * 11 % 20000,
+            (i & 1) ? "true" : "false", i * 17 % 90000, lang, i * 1009);
+
+        bench_appendf(b,
+            "\"geo\":null,\"coordinates\":null,\"place\":null,\"contributors\":null,"
+            "\"retweet_count\":%zu,\"favorite_count\":%zu,"
+            "\"entities\":{\"hashtags\":[{\"text\":\"tag%zu\",\"indices\":[%zu,%zu]}],\"symbols\":[],\"urls\":[],"
+            "\"user_mentions\":[{\"screen_name\":\"aym0566x\",\"name\":\"Mention\",\"id\":%zu,"
+            "\"id_str\":\"%zu\",\"indices\":[0,9]}]},"
+            "\"favorited\":false,\"retweeted\":false,\"lang\":\"%s\"}",
+            i % 300, i % 70, i % 97, i % 60, i % 60 + 6, i * 5, i * 5, lang);
+
+        ++i;
+    }
+
+    bench_appendf(b, "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,"
+                  "\"query\":\"%%E4%%B8%%80\",\"count\":%zu,\"since_id\":0}}", i);
+}
+
+
+/* citm_catalog.json-like: id-keyed maps of events and an array of performances */
+static void
+bench_gen_citm(struct bench_buf_t *b, size_t size)
+{
+    size_t events = size / 1024 + 1;
+    size_t i;
+
+    bench_appendf(b, "{\"areaNames\":{");
+
+    for (i = 0; i < 64; ++i) {
+        bench_appendf(b, "%s\"%zu\":\"Area %zu - balcony\"", i ? "," : "", 205705993 + i, i);
+    }
+
+    bench_appendf(b, "},\"events\":{");
+
+    for (i = 0; i < events; ++i) {
+        bench_appendf(b,
+            "%s\"%zu\":{\"description\":null,\"id\":%zu,\"logo\":%s,\"name\":\"Event %zu\","
+            "\"subTopicIds\":[337184269,337184283,%zu],\"subjectCode\":null,\"subtitle\":null,"
+            "\"topicIds\":[324846099,%zu]}",
+            i ? "," : "", 138586341 + i, 138586341 + i,
+            (i % 3) ? "null" : "\"\\/images\\/UE0AAAAACEKo6QAAAAZDSVRN\"", i, 337184000 + i % 50,
+            107888604 + i % 7);
+    }
+
+    bench_appendf(b, "},\"performances\":[");
+
+    for (i = 0; b->len < size; ++i) {
+        bench_appendf(b,
+            "%s{\"eventId\":%zu,\"id\":%zu,\"logo\":null,\"name\":null,"
+            "\"prices\":[{\"amount\":%zu,\"audienceSubCategoryId\":337100890,\"seatCategoryId\":338937295},"
+            "{\"amount\":%zu,\"audienceSubCategoryId\":337100890,\"seatCategoryId\":338937296}],"
+            "\"seatCategories\":[{\"areas\":[{\"areaId\":205705999,\"blockIds\":[]},"
+            "{\"areaId\":%zu,\"blockIds\":[]}],\"seatCategoryId\":338937295}],"
+            "\"seatMapImage\":null,\"start\":%llu,\"venueCode\":\"PLEYEL_PLEYEL\"}",
+            i ? "," : "", 138586341 + i % events, 339187287 + i, 90250 + (i % 40) * 250,
+            28500 + (i % 12) * 500, 205705993 + i % 64, 1372701600000ull + (unsigned long long)i * 86400000);
+    }
+
+    bench_appendf(b, "],\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}");
+}
+
+
+/* one long flat array of small mixed scalars */
+static void
+bench_gen_array(struct bench_buf_t *b, size_t size)
+{
+    bench_appendf(b, "[");
+
+    for (size_t i = 0; b->len < size; ++i) {
+        switch (i % 4) {
+        case 0:
+            bench_appendf(b, "%s%zu", i ? "," : "", i);
+            break;
+        case 1:
+            bench_appendf(b, ",-%zu", i * 7);
+            break;
+        case 2:
+            bench_appendf(b, ",%s", (i & 8) ? "true" : "null");
+            break;
+        default:
+            bench_appendf(b, ",\"v%zu\"", i % 1000);
+            break;
+        }
+    }
+
+    bench_appendf(b, "]");
+}
+
+
+/* subtrees nested BENCH_SUITE_DEPTH / 2 deep, alternating objects and arrays */
+static void
+bench_gen_deep(struct bench_buf_t *b, size_t size)
+{
+    size_t depth = BENCH_SUITE_DEPTH / 2 - 2;
+
+    bench_appendf(b, "[");
+
+    for (size_t i = 0; b->len < size; ++i) {
+        bench_appendf(b, i ? "," : "");
+
+        for (size_t d = 0; d < depth; ++d) {
+            bench_appendf(b, (d & 1) ? "{\"k%zu\":" : "[%zu,", d % 10);
+        }
+
+        bench_appendf(b, "%zu", i);
+
+        for (size_t d = depth; d-- > 0;) {
+            bench_appendf(b, (d & 1) ? "}" : "]");
+        }
+    }
+
+    bench_appendf(b, "]");
+}
+
+
+/* integers and doubles with no structure to speak of */
+static void
+bench_gen_integers(struct bench_buf_t *b, size_t size)
+{
+    bench_appendf(b, "{\"ints\":[");
+
+    for (size_t i = 0; b->len < size / 2; ++i) {
+        bench_appendf(b, "%s%lld", i ? "," : "", (long long)((i * 2654435761u) % 4000000000u) - 2000000000);
+    }
+
+    bench_appendf(b, "],\"doubles\":[");
+
+    for (size_t i = 0; b->len < size; ++i) {
+        bench_appendf(b, "%s%.17g", i ? "," : "", (double)(i * 40503u % 1000003) / 997.0 - 500.0);
+    }
+
+    bench_appendf(b, "]}");
+}
+
+
+static size_t
+bench_load_corpus(struct bench_doc_t *docs, size_t n, const char *dir)
+{
+    DIR *d = opendir(dir);
+    struct dirent *e;
+
+    if (!d) {
+        fprintf(stderr, "cannot open %s\n", dir);
+        exit(1);
+    }
+
+    while ((n < BENCH_SUITE_DOCS) && (e = readdir(d))) {
+        size_t len = strlen(e->d_name);
+        char path[4096];
+        struct stat st;
+
+        if ((len < 6) || strcmp(e->d_name + len - 5, ".json")) {
+            continue;
+        }
+
+        snprintf(path, sizeof path, "%s/%s", dir, e->d_name);
+
+        int fd = open(path, O_RDONLY);
+        if ((fd < 0) || fstat(fd, &st)) {
+            continue;
+        }
+
+        struct bench_doc_t *doc = &docs[n];
+        memset(doc, 0, sizeof *doc);
+        snprintf(doc->name, sizeof doc->name, "%.*s", (int)(len - 5), e->d_name);
+
+        /* the name goes into --format=json output as is */
+        for (char *c = doc->name; *c; ++c) {
+            if (('"' == *c) || ('\\' == *c) || ((unsigned char)*c < 0x20)) {
+                *c = '_';
+            }
+        }
+
+        doc->buf.cap = doc->buf.len = (size_t)st.st_size;
+        doc->buf.data = malloc(doc->buf.cap ? doc->buf.cap : 1);
+
+        if (read(fd, doc->buf.data, doc->buf.len) == (ssize_t)doc->buf.len) {
+            ++n;
+        }
+        else {
+            free(doc->buf.data);
+        }
+
+        close(fd);
+    }
+
+    closedir(d);
+
+    return n;
+}
+
+
+static int
+bench_op_sax(struct bench_suite_t *s, const char *str, size_t len)
+{
+    struct json_parser_handler_t h = { &bench_null_handler_vtbl, NULL };
+    return json_read_str(str, len, &h);
+}
+
+
+static int
+bench_op_dom(struct bench_suite_t *s, const char *str, size_t len)
+{
+    return json_parse_str(&s->parser, str, len);
+}
+
+
+static int
+bench_op_release(struct bench_suite_t *s, const char *str, size_t len)
+{
+    json_parser_clear(&s->malloc_parser);
+    return 0;
+}
+
+
+static int
+bench_op_dom_malloc(struct bench_suite_t *s, const char *str, size_t len)
+{
+    return json_parse_str(&s->malloc_parser, str, len);
+}
+
+
+static int
+bench_op_free(struct bench_suite_t *s, const char *str, size_t len)
+{
+    json_value_free(s->malloc_parser.a, s->malloc_parser.root, 0);
+    s->malloc_parser.root = NULL;
+
+    return 0;
+}
+
+
+static int
+bench_op_write(struct bench_suite_t *s, const char *str, size_t len)
+{
+    s->out.len = 0;
+    return json_write(&s->out_stream, s->parser.root, 0);
+}
+
+
+static int
+bench_op_roundtrip(struct bench_suite_t *s, const char *str, size_t len)
+{
+    return bench_op_dom(s, str, len) || bench_op_write(s, str, len);
+}
+
+
+/* run is timed, prepare is not */
+static const struct bench_op_t
+bench_ops[] = {
+    { "sax", NULL, &bench_op_sax },
+    { "dom", NULL, &bench_op_dom },
+    { "dom_malloc", &bench_op_release, &bench_op_dom_malloc },
+    { "free_malloc", &bench_op_dom_malloc, &bench_op_free },
+    { "write", &bench_op_dom, &bench_op_write },
+    { "roundtrip", NULL, &bench_op_roundtrip }
+};
+
+
+static int
+bench_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* nearest rank */
+static double
+bench_percentile(const double *sorted, int n, int p)
+{
+    int rank = (p * n + 99) / 100;
+
+    return sorted[(rank > 0) ? rank - 1 : 0];
+}
+
+
+static void
+bench_suite_run(struct bench_suite_t *s, const struct bench_doc_t *doc, const struct bench_op_t *op)
+{
+    const char *str = doc->buf.data;
+    size_t len = doc->buf.len;
+
+    for (int i = 0; i < s->warmup + s->reps; ++i) {
+        if (op->prepare && op->prepare(s, str, len)) {
+            fprintf(stderr, "%s: %s failed to prepare\n", doc->name, op->name);
+            exit(1);
+        }
+
+        double begin = bench_now();
+        int r = op->run(s, str, len);
+        double seconds = bench_now() - begin;
+
+        if (r) {
+            fprintf(stderr, "%s: %s failed (%d)\n", doc->name, op->name, r);
+            exit(1);
+        }
+
+        if (i >= s->warmup) {
+            s->samples[i - s->warmup] = seconds;
+        }
+    }
+
+    qsort(s->samples, s->reps, sizeof(double), &bench_compare_double);
+
+    double p50 = bench_percentile(s->samples, s->reps, 50);
+    double p90 = bench_percentile(s->samples, s->reps, 90);
+    double p99 = bench_percentile(s->samples, s->reps, 99);
+    double mbs = (double)len / p50 / (1024 * 1024);
+
+    if (s->json) {
+        printf("{\"doc\":\"%s\",\"bytes\":%zu,\"op\":\"%s\",\"reps\":%d,\"mb_s\":%.2f,\"docs_s\":%.2f,"
+               "\"min_ms\":%.4f,\"p50_ms\":%.4f,\"p90_ms\":%.4f,\"p99_ms\":%.4f}\n",
+               doc->name, len, op->name, s->reps, mbs, 1 / p50,
+               s->samples[0] * 1e3, p50 * 1e3, p90 * 1e3, p99 * 1e3);
+    }
+    else {
+        printf("%-14s %-12s %9.1f MB/s %10.1f docs/s  p50 %9.3f  p90 %9.3f  p99 %9.3f ms\n",
+               doc->name, op->name, mbs, 1 / p50, p50 * 1e3, p90 * 1e3, p99 * 1e3);
+    }
+
+    fflush(stdout);
+}
+
+
+static int
+bench_suite(int argc, char *argv[])
+{
+    struct bench_doc_t docs[BENCH_SUITE_DOCS];
+    const char *corpus = NULL;
+    size_t scale = 1;
+    size_t n = 0;
+    struct bench_suite_t s;
+
+    s.warmup = 3;
+    s.reps = 20;
+    s.json = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        if (!strncmp(argv[i], "--reps=", 7)) {
+            s.reps = atoi(argv[i] + 7);
+        }
+        else if (!strncmp(argv[i], "--warmup=", 9)) {
+            s.warmup = atoi(argv[i] + 9);
+        }
+        else if (!strncmp(argv[i], "--scale=", 8)) {
+            scale = (size_t)atoi(argv[i] + 8);
+        }
+        else if (!strcmp(argv[i], "--format=json")) {
+            s.json = 1;
+        }
+        else if (!strncmp(argv[i], "--corpus=", 9)) {
+            corpus = argv[i] + 9;
+        }
+        else {
+            fprintf(stderr, "usage: %s --suite [--reps=N] [--warmup=N] [--scale=N] [--format=json] [--corpus=DIR]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if ((s.reps < 1) || (s.warmup < 0) || (scale < 1)) {
+        fprintf(stderr, "bad --reps, --warmup or --scale\n");
+        return 1;
+    }
+
+    static const struct {
+        const char *name;
+        void(*gen)(struct bench_buf_t *b, size_t size);
+        size_t size;
+    } gens[] = {
+        { "twitter", &bench_gen_twitter, 600 * 1024 },
+        { "citm_catalog", &bench_gen_citm, 1700 * 1024 },
+        { "canada", &bench_gen_numbers, 2200 * 1024 },
+        { "records", &bench_gen_records, 2 * 1024 * 1024 },
+        { "array", &bench_gen_array, 4 * 1024 * 1024 },
+        { "deep", &bench_gen_deep, 1024 * 1024 },
+        { "strings", &bench_gen_strings, 2 * 1024 * 1024 },
+        { "unicode", &bench_gen_unicode, 2 * 1024 * 1024 },
+        { "numbers", &bench_gen_integers, 2 * 1024 * 1024 }
+    };
+
+    for (size_t i = 0; i < sizeof gens / sizeof gens[0]; ++i, ++n) {
+        memset(&docs[n], 0, sizeof docs[n]);
+        snprintf(docs[n].name, sizeof docs[n].name, "%s", gens[i].name);
+        gens[i].gen(&docs[n].buf, gens[i].size * scale);
+    }
+
+    if (corpus) {
+        n = bench_load_corpus(docs, n, corpus);
+    }
+
+    s.samples = malloc(s.reps * sizeof(double));
+
+    json_parser_init(&s.parser, BENCH_SUITE_DEPTH, NULL);
+
+    s.malloc_allocator.vtbl = &bench_malloc_allocator_vtbl;
+    s.malloc_allocator.ctx = NULL;
+    json_parser_init(&s.malloc_parser, BENCH_SUITE_DEPTH, &s.malloc_allocator);
+
+    json_buf_stream_init(&s.out_stream, &s.out);
+
+    if (s.json) {
+        printf("{\"simd\":\"%s\",\"cpus\":%ld,\"warmup\":%d,\"reps\":%d}\n",
+               json_simd()->name, sysconf(_SC_NPROCESSORS_ONLN), s.warmup, s.reps);
+    }
+    else {
+        printf("simd: %s, %ld cpus, %d warmup, %d reps, latencies per document\n",
+               json_simd()->name, sysconf(_SC_NPROCESSORS_ONLN), s.warmup, s.reps);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        /* a corpus file this parser rejects is reported, not timed */
+        int r = json_parse_str(&s.parser, docs[i].buf.data, docs[i].buf.len);
+
+        if (r) {
+            fprintf(stderr, "%s: not parsed (%d), skipped\n", docs[i].name, r);
+        }
+        else {
+            for (size_t j = 0; j < sizeof bench_ops / sizeof bench_ops[0]; ++j) {
+                bench_suite_run(&s, &docs[i], &bench_ops[j]);
+            }
+        }
+
+        free(docs[i].buf.data);
+    }
+
+    json_parser_clear(&s.parser);
+    json_parser_clear(&s.malloc_parser);
+    free(s.out.data);
+    free(s.samples);
+
+    return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    if ((argc > 1) && !strcmp(argv[1], "--suite")) {
+        return bench_suite(argc, argv);
+    }
+
+    size_t size_mb = (argc > 1) ? (size_t)atoi(argv[1]) : 16;
+    int iterations = (argc > 2) ? atoi(argv[2]) : 10;
+
+    struct bench_buf_t docs[4] = { { 0 } };
+    const char *names[4] = { "records", "strings", "numbers", "unicode" };
+
+    bench_gen_records(&docs[0], size_mb * 1024 * 1024);
+    bench_gen_strings(&docs[1], size_mb * 1024 * 1024);
+    bench_gen_numbers(&docs[2], size_mb * 1024 * 1024);
+    bench_gen_unicode(&docs[3], size_mb * 1024 * 1024);
+
+    struct json_parser_t parser = { 0 };
+    json_parser_init(&parser, 64, NULL);
+
+    struct json_allocator_t malloc_allocator = { &bench_malloc_allocator_vtbl, NULL };
+    struct json_parser_t malloc_parser = { 0 };
+    json_parser_init(&malloc_parser, 64, &malloc_allocator);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    printf("simd: %s, %d iterations, %ld cpus\n", json_simd()->name, iterations, cpus);
+
+    for (int i = 0; i < 4; ++i) {
+        struct bench_buf_t *doc = &docs[i];
+
+        printf("%s: %zu bytes\n", names[i], doc->len);
+
+        bench_report("json_parse_stream", doc->len, iterations,
+                     bench_parse_stream(&parser, doc->data, doc->len, iterations));
+
+        char path[] = "/tmp/json_bench.XXXXXX";
+        bench_save(path, doc->data, doc->len);
+
+        bench_report("json_parse_fd", doc->len, iterations,
+                     bench_parse_fd(&parser, path, iterations));
+
+        bench_report("json_parse_file (mmap)", doc->len, iterations,
+                     bench_parse_file(&parser, path, iterations));
+
+        unlink(path);
+
+        char bin_path[] = "/tmp/json_bench.XXXXXX";
+        printf("  binary image: %zu bytes\n", bench_bin_save(&parser, doc->data, doc->len, bin_path));
+
+        bench_report("json_bin_open (mmap)", doc->len, iterations,
+                     bench_bin_mmap(bin_path, iterations));
+
+        unlink(bin_path);
+
+        bench_report("json_bin_decode", doc->len, iterations,
+                     bench_bin_decode(&parser, doc->data, doc->len, iterations));
+
+        bench_report("json_bin_encode", doc->len, iterations,
+                     bench_bin_encode(&parser, doc->data, doc->len, iterations));
+
+        bench_report("json_parse_str (malloc)", doc->len, iterations,
+                     bench_parse_str(&malloc_parser, doc->data, doc->len, iterations));
+
+        bench_report("json_parse_str", doc->len, iterations,
+                     bench_parse_str(&parser, doc->data, doc->len, iterations));
+
+        parser.flags |= JSON_PARSER_VALIDATE_UTF8;
+
+        bench_report("json_parse_str (utf8)", doc->len, iterations,
+                     bench_parse_str(&parser, doc->data, doc->len, iterations));
+
+        parser.flags &= ~JSON_PARSER_VALIDATE_UTF8;
+
+        bench_report("json_utf8_validate", doc->len, iterations,
+                     bench_utf8_validate(doc->data, doc->len, iterations));
+
+        for (unsigned threads = 2; (threads <= 32) && (threads <= cpus); threads *= 2) {
+            char name[32];
+            snprintf(name, sizeof name, "json_parse_str (%u)", threads);
+
+            bench_report(name, doc->len, iterations,
+                         bench_parse_parallel(&parser, doc->data, doc->len, iterations, threads));
+        }
+
+        bench_report("json_read_str (sax)", doc->len, iterations,
+                     bench_read_str(doc->data, doc->len, iterations));
+
+        bench_report("json_feed (sax, 4 KiB)", doc->len, iterations,
+                     bench_push(NULL, doc->data, doc->len, iterations));
+
+        bench_report("json_feed (dom, 4 KiB)", doc->len, iterations,
+                     bench_push(&parser, doc->data, doc->len, iterations));
+
+        if (!i) {
+            bench_report("json_cursor (2 fields)", doc->len, iterations,
+                         bench_cursor(doc->data, doc->len, iterations));
+        }
+
+        bench_report("json_write", doc->len, iterations,
+                     bench_write(&parser, doc->data, doc->len, iterations, 0));
+
+        bench_report("json_write (pretty)", doc->len, iterations,
+                     bench_write(&parser, doc->data, doc->len, iterations, JSON_WRITER_PRETTY));
+
+        bench_report("json_read_str -> writer", doc->len, iterations,
+                     bench_read_write(doc->data, doc->len, iterations));
+
+        free(doc->data);
+    }
+
+    struct bench_buf_t lines = { 0 };
+    bench_gen_lines(&lines, size_mb * 1024 * 1024);
+
+    printf("ndjson: %zu bytes\n", lines.len);
+
+    bench_report("json_parse_str per line", lines.len, iterations,
+                 bench_lines(&parser, lines.data, lines.len, iterations));
+
+    struct json_keys_t keys;
+    json_keys_init(&keys, 0);
+    parser.keys = &keys;
+
+    bench_report("json_parse_str (keys)", lines.len, iterations,
+                 bench_lines(&parser, lines.data, lines.len, iterations));
+
+    parser.keys = NULL;
+    json_keys_free(&keys);
+
+#if JSON_PARSER_STATS
+    struct json_parser_stats_t stats;
+    memset(&stats, 0, sizeof stats);
+    parser.stats = &stats;
+
+    bench_report("json_parse_str (stats)", lines.len, iterations,
+                 bench_lines(&parser, lines.data, lines.len, iterations));
+
+    parser.stats = NULL;
+
+    printf("  %llu parses, %.0f ns and %.0f cycles each, %llu values, %llu allocs, %.1f%% of string bytes escaped\n",
+           (unsigned long long)stats.parses, (double)stats.nsec / stats.parses, (double)stats.cycles / stats.parses,
+           (unsigned long long)(stats.values[JSON_VALUE_TYPE_NULL] + stats.values[JSON_VALUE_TYPE_BOOL]
+               + stats.values[JSON_VALUE_TYPE_INT] + stats.values[JSON_VALUE_TYPE_INT64]
+               + stats.values[JSON_VALUE_TYPE_UINT64] + stats.values[JSON_VALUE_TYPE_DOUBLE]
+               + stats.values[JSON_VALUE_TYPE_STRING] + stats.values[JSON_VALUE_TYPE_OBJECT]
+               + stats.values[JSON_VALUE_TYPE_ARRAY]),
+           (unsigned long long)stats.allocs, 100.0 * stats.string_bytes_escaped / stats.string_bytes);
+    printf("  %.3f heap allocs per parse\n", (double)stats.heap_allocs / stats.parses);
+#endif
+
+    parser.flags |= JSON_PARSER_REUSE;
+
+    bench_report("json_parse_str (reuse)", lines.len, iterations,
+                 bench_lines(&parser, lines.data, lines.len, iterations));
+
+#if JSON_PARSER_STATS
+    memset(&stats, 0, sizeof stats);
+    parser.stats = &stats;
+
+    bench_lines(&parser, lines.data, lines.len, 1);
+
+    parser.stats = NULL;
+
+    printf("  %.3f heap allocs per parse\n", (double)stats.heap_allocs / stats.parses);
+#endif
+
+    parser.flags &= ~JSON_PARSER_REUSE;
+
+    bench_report("json_doc_freeze per line", lines.len, iterations,
+                 bench_freeze_lines(&parser, lines.data, lines.len, iterations));
+
+    /* a service seeing the same 1024 payloads over and over */
+    const char *repeat_end = lines.data;
+
+    for (int i = 0; (i < 1024) && repeat_end; ++i) {
+        repeat_end = memchr(repeat_end, '\n', lines.data + lines.len - repeat_end);
+        repeat_end = repeat_end ? repeat_end + 1 : NULL;
+    }
+
+    size_t repeat_len = repeat_end ? (size_t)(repeat_end - lines.data) : lines.len;
+    int repeats = iterations * (int)(lines.len / repeat_len);
+
+    bench_report("json_parse_str (repeats)", repeat_len, repeats,
+                 bench_lines(&parser, lines.data, repeat_len, repeats));
+
+    struct json_cache_t cache;
+    struct json_cache_stats_t cache_stats;
+
+    if (json_cache_init(&cache, 0)) {
+        fprintf(stderr, "json_cache_init failed\n");
+        exit(1);
+    }
+
+    bench_report("json_cache_parse", repeat_len, repeats,
+                 bench_cache_lines(&cache, &parser, lines.data, repeat_len, repeats));
+
+    json_cache_stats(&cache, &cache_stats);
+    printf("  %llu hits, %llu misses, %zu docs in %zu bytes\n",
+           (unsigned long long)cache_stats.hits, (unsigned long long)cache_stats.misses,
+           cache_stats.docs, cache_stats.bytes);
+
+    json_cache_free(&cache);
+
+    bench_report("json_read_path per line", lines.len, iterations,
+                 bench_path_lines(lines.data, lines.len, iterations));
+
+    bench_report("dom + copy to struct", lines.len, iterations,
+                 bench_messages(&parser, lines.data, lines.len, iterations));
+
+    bench_report("json_bind_str", lines.len, iterations,
+                 bench_messages(NULL, lines.data, lines.len, iterations));
+
+    for (unsigned threads = 1; threads <= 32; threads *= 2) {
+        char name[32];
+        snprintf(name, sizeof name, "json_parse_ndjson (%u)", threads);
+
+        bench_report(name, lines.len, iterations, bench_ndjson(lines.data, lines.len, iterations, threads));
+
+        if ((long)threads >= cpus) {
+            break;
+        }
+    }
+
+    free(lines.data);
+
+    bench_objects(&parser);
+
+    json_parser_clear(&parser);
+    json_parser_clear(&malloc_parser);
+
+    return 0;
+}
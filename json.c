@@ -1,44 +1,201 @@
 #include "json.h"
+#include "json_utf8.h"
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 
+/* the i-th child of v, NULL past the last one or if v is no container */
+static inline struct json_value_t *
+json_value_child(struct json_value_t *v, size_t i)
+{
+    if (JSON_VALUE_TYPE_OBJECT == v->type) {
+        return (i < v->obj.size) ? &v->obj.elts[i].val : NULL;
+    }
+
+    if (JSON_VALUE_TYPE_ARRAY == v->type) {
+        return (i < v->arr.size) ? &v->arr.elts[i] : NULL;
+    }
+
+    return NULL;
+}
+
+
+/* where child sits among its parent's children */
+static inline size_t
+json_value_position(const struct json_value_t *parent, const struct json_value_t *child)
+{
+    if (JSON_VALUE_TYPE_OBJECT == parent->type) {
+        const char *elt = (const char *)child - offsetof(struct json_object_elt_t, val);
+        return (const struct json_object_elt_t *)elt - parent->obj.elts;
+    }
+
+    return child - parent->arr.elts;
+}
+
+
+/*
+ * depth first without recursion: the walk goes down into the next child
+ * that is a container and back up by the parent pointers, which
+ * json_value_adopt keeps right, so any depth takes constant stack.
+ */
 void
 json_value_free(struct json_allocator_t *a, struct json_value_t *v, int dont_free)
 {
+    struct json_value_t *p = v;
+    struct json_value_t *c;
+    size_t i = 0;
+
     if (!v) {
         return;
     }
 
-    if (JSON_VALUE_TYPE_OBJECT == v->type) {
+    while (1) {
+        while ((c = json_value_child(p, i))) {
+            if ((JSON_VALUE_TYPE_OBJECT == c->type) || (JSON_VALUE_TYPE_ARRAY == c->type)) {
+                p = c;
+                i = 0;
+            }
+            else {
+                ++i;
+            }
+        }
 
-        struct json_object_elt_t *elt = v->obj.head;
-        struct json_object_elt_t *p;
+        /* the children of p are done with */
+        if (JSON_VALUE_TYPE_OBJECT == p->type) {
+            if (p->obj.elts) {
+                a->vtbl->on_free(a->ctx, p->obj.elts);
+            }
+
+            if (p->obj.index) {
+                a->vtbl->on_free(a->ctx, p->obj.index);
+            }
+        }
+        else if (JSON_VALUE_TYPE_ARRAY == p->type) {
+            if (p->arr.elts) {
+                a->vtbl->on_free(a->ctx, p->arr.elts);
+            }
+        }
+
+        if (p == v) {
+            break;
+        }
+
+        c = p;
+        p = p->parent;
+        i = json_value_position(p, c) + 1;
+    }
+
+    if (!dont_free) {
+        a->vtbl->on_free(a->ctx, v);
+    }
+}
 
-        while (elt) {
-            p = elt;
-            elt = elt->next;
 
-            json_value_free(a, &p->val, 1);
-            a->vtbl->on_free(a->ctx, p);
+void
+json_value_adopt(struct json_value_t *v)
+{
+    if (JSON_VALUE_TYPE_OBJECT == v->type) {
+        for (size_t i = 0; i < v->obj.size; ++i) {
+            v->obj.elts[i].val.parent = v;
         }
     }
     else if (JSON_VALUE_TYPE_ARRAY == v->type) {
+        for (size_t i = 0; i < v->arr.size; ++i) {
+            v->arr.elts[i].parent = v;
+        }
+    }
+}
 
-        struct json_array_elt_t *elt = v->arr.head;
-        struct json_array_elt_t *p;
 
-        while (elt) {
-            p = elt;
-            elt = elt->next;
+static int
+json_string_copy(struct json_arena_t *arena, struct json_string_t *str)
+{
+    size_t size = json_string_raw_size(str);
+
+    if (!size) {
+        str->data = "";
+        return 0;
+    }
+
+    char *p = json_arena_alloc(arena, size);
+    if (!p) {
+        return -1;
+    }
+
+    memcpy(p, str->data, size);
+    str->data = p;
+
+    return 0;
+}
+
+
+/* walks v's tree as json_value_free does, keys as their members come up */
+int
+json_value_copy_strings(struct json_arena_t *arena, struct json_value_t *v)
+{
+    struct json_value_t *p = v;
+    struct json_value_t *c;
+    size_t i = 0;
+
+    if (JSON_VALUE_TYPE_STRING == v->type) {
+        return json_string_copy(arena, &v->str);
+    }
+
+    while (1) {
+        while ((c = json_value_child(p, i))) {
+            if ((JSON_VALUE_TYPE_OBJECT == p->type) && json_string_copy(arena, &p->obj.elts[i].key)) {
+                return -1;
+            }
+
+            if ((JSON_VALUE_TYPE_OBJECT == c->type) || (JSON_VALUE_TYPE_ARRAY == c->type)) {
+                p = c;
+                i = 0;
+                continue;
+            }
+
+            if ((JSON_VALUE_TYPE_STRING == c->type) && json_string_copy(arena, &c->str)) {
+                return -1;
+            }
+
+            ++i;
+        }
 
-            json_value_free(a, &p->data, 1);
-            a->vtbl->on_free(a->ctx, p);
+        if (p == v) {
+            break;
         }
+
+        c = p;
+        p = p->parent;
+        i = json_value_position(p, c) + 1;
     }
 
-    if (!dont_free) {
-        a->vtbl->on_free(a->ctx, v);
+    return 0;
+}
+
+
+static void *
+json_value_grow(struct json_allocator_t *a, void *elts, size_t size, size_t *capacity, size_t elt_size)
+{
+    if (size < *capacity) {
+        return elts;
+    }
+
+    size_t n = *capacity ? *capacity * 2 : 4;
+
+    void *p = a->vtbl->on_alloc(a->ctx, n * elt_size);
+    if (!p) {
+        return NULL;
+    }
+
+    if (elts) {
+        memcpy(p, elts, size * elt_size);
+        a->vtbl->on_free(a->ctx, elts);
     }
+
+    *capacity = n;
+
+    return p;
 }
 
 
@@ -51,29 +208,40 @@ json_value_add(struct json_allocator_t *a, struct json_value_t *v, enum json_val
         p = a->vtbl->on_alloc(a->ctx, sizeof(struct json_value_t));
     }
     else if (JSON_VALUE_TYPE_OBJECT == v->type) {
-        assert(v->obj.tail);
-        p = &v->obj.tail->val;
-        ++v->obj.size;
+        assert(v->obj.size && (JSON_VALUE_TYPE_NONE == v->obj.elts[v->obj.size - 1].val.type));
+        p = &v->obj.elts[v->obj.size - 1].val;
     }
     else if (JSON_VALUE_TYPE_ARRAY == v->type) {
-        struct json_array_elt_t *elt = a->vtbl->on_alloc(a->ctx, sizeof(struct json_array_elt_t));
-        p = &elt->data;
-        elt->next = NULL;
-
-        if (v->arr.tail) {
-            v->arr.tail->next = elt;
+        struct json_value_t *elts = json_value_grow(a, v->arr.elts, v->arr.size, &v->arr.capacity,
+                                                    sizeof(struct json_value_t));
+        if (!elts) {
+            return NULL;
         }
-        else {
-            v->arr.head = elt;
+
+        if (elts != v->arr.elts) {
+            v->arr.elts = elts;
+
+            for (size_t i = 0; i < v->arr.size; ++i) {
+                json_value_adopt(&elts[i]);
+            }
         }
 
-        v->arr.tail = elt;
-        ++v->arr.size;
+        p = &v->arr.elts[v->arr.size++];
     }
 
     if (p) {
         p->type = type;
         p->parent = v;
+
+        if (JSON_VALUE_TYPE_OBJECT == type) {
+            p->obj.elts = NULL;
+            p->obj.size = p->obj.capacity = 0;
+            p->obj.index = NULL;
+        }
+        else if (JSON_VALUE_TYPE_ARRAY == type) {
+            p->arr.elts = NULL;
+            p->arr.size = p->arr.capacity = 0;
+        }
     }
 
     return p;
@@ -85,65 +253,451 @@ json_value_add_key(struct json_allocator_t *a, struct json_value_t *v, char *str
 {
     assert(JSON_VALUE_TYPE_OBJECT == v->type);
 
-    struct json_object_elt_t *p = a->vtbl->on_alloc(a->ctx, sizeof(struct json_object_elt_t));
+    if (v->obj.index) {
+        a->vtbl->on_free(a->ctx, v->obj.index);
+        v->obj.index = NULL;
+    }
+
+    struct json_object_elt_t *elts = json_value_grow(a, v->obj.elts, v->obj.size, &v->obj.capacity,
+                                                     sizeof(struct json_object_elt_t));
+    if (!elts) {
+        return NULL;
+    }
+
+    if (elts != v->obj.elts) {
+        v->obj.elts = elts;
+
+        for (size_t i = 0; i < v->obj.size; ++i) {
+            json_value_adopt(&elts[i].val);
+        }
+    }
+
+    struct json_object_elt_t *p = &v->obj.elts[v->obj.size++];
     p->key.data = str;
     p->key.len = len;
     p->val.type = JSON_VALUE_TYPE_NONE;
     p->val.parent = v;
-    p->next = NULL;
 
-    if (v->obj.tail) {
-        v->obj.tail->next = p;
+    return p;
+}
+
+
+#define JSON_HASH_SEED      UINT64_C(0xcbf29ce484222325)
+#define JSON_HASH_PRIME     UINT64_C(0x100000001b3)
+
+#define JSON_HASH_STEP(h, c) (((h) ^ (unsigned char)(c)) * JSON_HASH_PRIME)
+
+
+uint64_t
+json_hash(const char *s, size_t len)
+{
+    uint64_t h = JSON_HASH_SEED;
+
+    for (size_t i = 0; i < len; ++i) {
+        h = JSON_HASH_STEP(h, s[i]);
     }
-    else {
-        v->obj.head = p;
+
+    return h;
+}
+
+
+uint64_t
+json_string_hash(const struct json_string_t *str)
+{
+    const char *p = str->data;
+    uint64_t h = JSON_HASH_SEED;
+    char buf[JSON_UTF8_MAX];
+
+    for (size_t i = 0; i < str->len;) {
+        if ('\\' != *p) {
+            h = JSON_HASH_STEP(h, *p++);
+            ++i;
+            continue;
+        }
+
+        size_t n = json_unescape(p + 1, buf, &p);
+
+        for (size_t k = 0; k < n; ++k) {
+            h = JSON_HASH_STEP(h, buf[k]);
+        }
+
+        i += n;
+    }
+
+    return h;
+}
+
+
+size_t
+json_string_raw_size(const struct json_string_t *str)
+{
+    const char *p = str->data;
+    char buf[JSON_UTF8_MAX];
+
+    for (size_t i = 0; i < str->len;) {
+        const char *escape = memchr(p, '\\', str->len - i);
+
+        if (!escape) {
+            return p + (str->len - i) - str->data;
+        }
+
+        i += escape - p;
+        i += json_unescape(escape + 1, buf, &p);
+    }
+
+    return p - str->data;
+}
+
+
+int
+json_string_is_plain(const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        if (('\\' == s[i]) || ('"' == s[i]) || ((unsigned char)s[i] < 0x20)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+int
+json_string_equal(const struct json_string_t *str, const char *s, size_t len)
+{
+    if (str->len != len) {
+        return 0;
+    }
+
+    const char *p = str->data;
+    const char *escape = memchr(p, '\\', len);
+
+    if (!escape) {
+        return !memcmp(p, s, len);
+    }
+
+    size_t i = escape - p;
+    if (memcmp(p, s, i)) {
+        return 0;
+    }
+
+    char buf[JSON_UTF8_MAX];
+
+    for (p = escape; i < len;) {
+        if ('\\' != *p) {
+            if (*p++ != s[i++]) {
+                return 0;
+            }
+
+            continue;
+        }
+
+        size_t n = json_unescape(p + 1, buf, &p);
+
+        if ((n > len - i) || memcmp(buf, s + i, n)) {
+            return 0;
+        }
+
+        i += n;
     }
 
-    v->obj.tail = p;
+    return 1;
+}
+
+
+static inline size_t
+json_object_index_mask(size_t size)
+{
+    size_t n = 2 * JSON_OBJECT_INDEX_THRESHOLD;
+
+    while (n < 2 * size) {
+        n *= 2;
+    }
+
+    return n - 1;
+}
+
+
+int
+json_object_index(struct json_allocator_t *a, struct json_value_t *v)
+{
+    assert(JSON_VALUE_TYPE_OBJECT == v->type);
+
+    if (v->obj.index || (v->obj.size < JSON_OBJECT_INDEX_THRESHOLD) || (v->obj.size >= 0x7FFFFFFF)) {
+        return 0;
+    }
+
+    size_t mask = json_object_index_mask(v->obj.size);
+
+    uint32_t *index = a->vtbl->on_alloc(a->ctx, (mask + 1) * sizeof(uint32_t));
+    if (!index) {
+        return -1;
+    }
+
+    memset(index, 0, (mask + 1) * sizeof(uint32_t));
+
+    for (size_t i = 0; i < v->obj.size; ++i) {
+        struct json_string_t *key = &v->obj.elts[i].key;
+        size_t slot = json_string_hash(key) & mask;
+
+        /* inserting in member order keeps the first of duplicate keys ahead in the probe chain */
+        while (index[slot]) {
+            slot = (slot + 1) & mask;
+        }
+
+        index[slot] = (uint32_t)(i + 1);
+    }
+
+    v->obj.index = index;
+
+    return 0;
+}
+
+
+struct json_value_t *
+json_object_get(const struct json_value_t *v, const char *key, size_t len)
+{
+    assert(JSON_VALUE_TYPE_OBJECT == v->type);
+
+    struct json_object_elt_t *elts = v->obj.elts;
+
+    if (!v->obj.index) {
+        for (size_t i = 0; i < v->obj.size; ++i) {
+            if (json_string_equal(&elts[i].key, key, len)) {
+                return &elts[i].val;
+            }
+        }
+
+        return NULL;
+    }
+
+    size_t mask = json_object_index_mask(v->obj.size);
+    size_t slot = json_hash(key, len) & mask;
+    uint32_t i;
+
+    while ((i = v->obj.index[slot])) {
+        if (json_string_equal(&elts[i - 1].key, key, len)) {
+            return &elts[i - 1].val;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return NULL;
+}
+
+
+size_t
+json_strcpy(char *dst, const struct json_string_t *str, size_t n)
+{
+    const char *p = str->data;
+    size_t i = 0;
+    char buf[JSON_UTF8_MAX];
+
+    if (n > str->len) {
+        n = str->len;
+    }
+
+    while (i < n) {
+        /* the source has at least as many bytes left as the copy */
+        const char *escape = memchr(p, '\\', n - i);
+
+        if (!escape) {
+            memcpy(dst + i, p, n - i);
+            return n;
+        }
+
+        memcpy(dst + i, p, escape - p);
+        i += escape - p;
+
+        /* a code point that does not fit is cut */
+        size_t k = json_unescape(escape + 1, buf, &p);
+        if (k > n - i) {
+            k = n - i;
+        }
+
+        memcpy(dst + i, buf, k);
+        i += k;
+    }
+
+    return i;
+}
+
+
+
+void
+json_arena_init(struct json_arena_t *arena, size_t chunk_size)
+{
+    arena->head = NULL;
+    arena->cursor = arena->limit = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : JSON_ARENA_CHUNK_SIZE;
+    arena->mallocs = 0;
+}
+
+
+#define JSON_ARENA_HEADER                                           \
+    ((sizeof(struct json_arena_chunk_t) + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1))
+
+
+static void *
+json_arena_grow(struct json_arena_t *arena, size_t size)
+{
+    size_t header = JSON_ARENA_HEADER;
+    size_t chunk_size = arena->chunk_size;
+
+    if (size > chunk_size / 4) {
+        chunk_size = size;
+    }
+    else if (arena->chunk_size < JSON_ARENA_CHUNK_SIZE_MAX) {
+        arena->chunk_size *= 2;
+    }
+
+    struct json_arena_chunk_t *chunk = malloc(header + chunk_size);
+    if (!chunk) {
+        return NULL;
+    }
+
+    ++arena->mallocs;
+    chunk->size = chunk_size;
+
+    char *p = (char *)chunk + header;
+
+    if ((chunk_size == size) && arena->head) {
+        chunk->next = arena->head->next;
+        arena->head->next = chunk;
+
+        return p;
+    }
+
+    chunk->next = arena->head;
+    arena->head = chunk;
+
+    arena->cursor = p + size;
+    arena->limit = p + chunk_size;
+
+    return p;
+}
+
+
+void *
+json_arena_alloc(struct json_arena_t *arena, size_t size)
+{
+    size = (size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+
+    if ((size_t)(arena->limit - arena->cursor) < size) {
+        return json_arena_grow(arena, size);
+    }
+
+    void *p = arena->cursor;
+    arena->cursor += size;
 
     return p;
 }
 
 
-size_t 
-json_strcpy(char *dst, struct json_string_t *str, size_t n)
-{
-    char *p;
-    size_t i;
-
-    for (i = 0, p = str->data; i < n && i < str->len; ++i, ++p) {
-        if ('\\' == *p) {
-            ++p;
-
-            switch (*p) {
-            case '\\':
-            case '/':
-            case '"':
-                break;
-            case 'b':
-                dst[i] = '\b';
-                continue;
-            case 'f':
-                dst[i] = '\f';
-                continue;
-            case 'n':
-                dst[i] = '\n';
-                continue;
-            case 'r':
-                dst[i] = '\r';
-                continue;
-            case 't':
-                dst[i] = '\t';
-                continue;
-            case 'u':
-            default:
-                return i;
-            }
-        }
-
-        dst[i] = *p;
-    }
-
-    return i;
-}
-
+void
+json_arena_release(struct json_arena_t *arena)
+{
+    struct json_arena_chunk_t *chunk = arena->head;
+
+    while (chunk) {
+        struct json_arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->head = NULL;
+    arena->cursor = arena->limit = NULL;
+}
+
+
+void
+json_arena_rewind(struct json_arena_t *arena)
+{
+    struct json_arena_chunk_t *chunk = arena->head;
+
+    if (!chunk) {
+        return;
+    }
+
+    if (chunk->next) {
+        size_t total = 0;
+
+        for (; chunk; chunk = chunk->next) {
+            total += chunk->size;
+        }
+
+        json_arena_release(arena);
+        arena->chunk_size = total;
+
+        return;
+    }
+
+    arena->cursor = (char *)chunk + JSON_ARENA_HEADER;
+    arena->limit = arena->cursor + chunk->size;
+}
+
+
+void
+json_arena_merge(struct json_arena_t *dst, struct json_arena_t *src)
+{
+    if (!src->head) {
+        return;
+    }
+
+    if (!dst->head) {
+        dst->head = src->head;
+        dst->cursor = src->cursor;
+        dst->limit = src->limit;
+    }
+    else {
+        /* behind dst's current chunk, which keeps serving allocations */
+        struct json_arena_chunk_t *tail = src->head;
+
+        while (tail->next) {
+            tail = tail->next;
+        }
+
+        tail->next = dst->head->next;
+        dst->head->next = src->head;
+    }
+
+    src->head = NULL;
+    src->cursor = src->limit = NULL;
+}
+
+
+static void *
+json_arena_on_alloc(void *ctx, size_t size)
+{
+    return json_arena_alloc(ctx, size);
+}
+
+
+static void
+json_arena_on_free(void *ctx, void *p)
+{
+}
+
+
+static void
+json_arena_on_reset(void *ctx)
+{
+    json_arena_release(ctx);
+}
+
+
+static struct json_allocator_vtbl_t
+json_arena_allocator_vtbl = {
+    &json_arena_on_alloc,
+    &json_arena_on_free,
+    &json_arena_on_reset
+};
+
+
+void
+json_arena_allocator(struct json_allocator_t *a, struct json_arena_t *arena)
+{
+    a->vtbl = &json_arena_allocator_vtbl;
+    a->ctx = arena;
+}
@@ -2,6 +2,12 @@
 #define _JSON_H_INCLUDED
 
 #include <stddef.h>
+#include <stdint.h>
+
+
+#ifndef JSON_OBJECT_INDEX_THRESHOLD
+#define JSON_OBJECT_INDEX_THRESHOLD 16
+#endif
 
 
 enum json_value_type_t {
@@ -13,6 +19,8 @@ enum json_value_type_t {
     JSON_VALUE_TYPE_STRING,
     JSON_VALUE_TYPE_OBJECT,
     JSON_VALUE_TYPE_ARRAY,
+    JSON_VALUE_TYPE_INT64,
+    JSON_VALUE_TYPE_UINT64,
 };
 
 struct json_string_t {
@@ -22,18 +30,20 @@ struct json_string_t {
 
 typedef double json_number_t;
 
-struct json_array_elt_t;
+struct json_value_t;
+struct json_object_elt_t;
 
 struct json_array_t {
-    struct json_array_elt_t *head;
-    struct json_array_elt_t *tail;
+    struct json_value_t *elts;
     size_t size;
+    size_t capacity;
 };
 
 struct json_object_t {
-    struct json_object_elt_t *head;
-    struct json_object_elt_t *tail;
+    struct json_object_elt_t *elts;
     size_t size;
+    size_t capacity;
+    uint32_t *index;
 };
 
 struct json_value_t {
@@ -42,6 +52,8 @@ struct json_value_t {
     union {
         char b;
         int i;
+        int64_t i64;
+        uint64_t u64;
         double d;
         struct json_string_t str;
         struct json_array_t arr;
@@ -51,19 +63,44 @@ struct json_value_t {
     struct json_value_t *parent;
 };
 
-struct json_array_elt_t {
-    struct json_value_t data;
-    struct json_array_elt_t *next;
-};
-
 struct json_object_elt_t {
     struct json_string_t key;
     struct json_value_t val;
-
-    struct json_object_elt_t *next;
 };
 
 
+static inline size_t
+json_array_size(const struct json_value_t *v)
+{
+    return v->arr.size;
+}
+
+
+static inline struct json_value_t *
+json_array_get(const struct json_value_t *v, size_t i)
+{
+    return (i < v->arr.size) ? &v->arr.elts[i] : NULL;
+}
+
+
+static inline size_t
+json_object_size(const struct json_value_t *v)
+{
+    return v->obj.size;
+}
+
+
+static inline struct json_object_elt_t *
+json_object_at(const struct json_value_t *v, size_t i)
+{
+    return (i < v->obj.size) ? &v->obj.elts[i] : NULL;
+}
+
+
+/* put_end's strings are overwritten by later reads: a parse keeps copies */
+#define JSON_STREAM_REUSES_BUFFER   0x1
+
+
 struct json_stream_vtbl_t {
     char(*peek)(void *ctx);
     char(*take)(void *ctx);
@@ -71,7 +108,11 @@ struct json_stream_vtbl_t {
     char*(*put_begin)(void *ctx);
     void(*put)(void *ctx, char c);
     void(*flush)(void *ctx);
-    size_t(*put_end)(void *ctx, char *begin);
+    size_t(*put_end)(void *ctx, char **begin);
+    size_t(*write)(void *ctx, const char *data, size_t len);
+
+    /* JSON_STREAM_* */
+    unsigned flags;
 };
 
 
@@ -84,6 +125,7 @@ struct json_stream_t {
 struct json_allocator_vtbl_t {
     void *(*on_alloc)(void *ctx, size_t size);
     void(*on_free)(void *ctx, void *p);
+    void(*on_reset)(void *ctx);
 };
 
 
@@ -93,12 +135,76 @@ struct json_allocator_t {
 };
 
 
+#define JSON_ARENA_CHUNK_SIZE       (64 * 1024)
+#define JSON_ARENA_CHUNK_SIZE_MAX   (4 * 1024 * 1024)
+#define JSON_ARENA_ALIGN            16
+
+
+struct json_arena_chunk_t {
+    struct json_arena_chunk_t *next;
+    size_t size;
+};
+
+
+struct json_arena_t {
+    struct json_arena_chunk_t *head;
+    char *cursor;
+    char *limit;
+    size_t chunk_size;
+
+    /* chunks malloc'ed over the arena's life */
+    size_t mallocs;
+};
+
+
+void json_arena_init(struct json_arena_t *arena, size_t chunk_size);
+
+void *json_arena_alloc(struct json_arena_t *arena, size_t size);
+
+void json_arena_release(struct json_arena_t *arena);
+
+/*
+ * drops everything allocated but keeps the memory. a single chunk is
+ * simply reused; several are freed and the next one the arena takes is
+ * their size summed, so after one more round an arena that keeps
+ * serving the same load rewinds in O(1) and never mallocs.
+ */
+void json_arena_rewind(struct json_arena_t *arena);
+
+/* hands src's chunks, and whatever lives in them, over to dst */
+void json_arena_merge(struct json_arena_t *dst, struct json_arena_t *src);
+
+void json_arena_allocator(struct json_allocator_t *a, struct json_arena_t *arena);
+
+
+/* needs the parent pointers of v's tree to be right, see json_value_adopt */
 void json_value_free(struct json_allocator_t *a, struct json_value_t *v, int dont_free);
 
+void json_value_adopt(struct json_value_t *v);
+
+/* every string and key of v's tree copied into arena, so that it points into nothing else */
+int json_value_copy_strings(struct json_arena_t *arena, struct json_value_t *v);
+
 struct json_value_t *json_value_add(struct json_allocator_t *a, struct json_value_t *v, enum json_value_type_t type);
 
 struct json_object_elt_t *json_value_add_key(struct json_allocator_t *a, struct json_value_t *v, char *str, size_t len);
 
-size_t json_strcpy(char *dst, struct json_string_t *str, size_t n);
+int json_object_index(struct json_allocator_t *a, struct json_value_t *v);
+
+/* what json_object_index files a key under: of the plain bytes, and of a key as the parser took it */
+uint64_t json_hash(const char *s, size_t len);
+
+uint64_t json_string_hash(const struct json_string_t *str);
+
+struct json_value_t *json_object_get(const struct json_value_t *v, const char *key, size_t len);
+
+size_t json_strcpy(char *dst, const struct json_string_t *str, size_t n);
+
+size_t json_string_raw_size(const struct json_string_t *str);
+
+/* unescaped bytes that can be kept as their own source form: no '\\', '"' or control character */
+int json_string_is_plain(const char *s, size_t len);
+
+int json_string_equal(const struct json_string_t *str, const char *s, size_t len);
 
 #endif //_JSON_H_INCLUDED
@@ -0,0 +1,971 @@
+#include "json_bin.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define JSON_BIN_MAGIC              "JSNB"
+#define JSON_BIN_ORDER              0x01020304
+
+#define JSON_BIN_ALIGN              8
+#define JSON_BIN_STRING_MAX         0xFFFFFFFF
+
+/* ints that fit next to the tag */
+#define JSON_BIN_INLINE_MIN         (-(INT64_C(1) << 59))
+#define JSON_BIN_INLINE_MAX         ((INT64_C(1) << 59) - 1)
+
+#define JSON_BIN_REF(tag, x)        (((uint64_t)(x) << 4) | (tag))
+#define JSON_BIN_TAG(v)             ((v) & 0xF)
+#define JSON_BIN_OFFSET(v)          ((v) >> 4)
+#define JSON_BIN_INLINE(v)          ((int64_t)(v) >> 4)
+
+
+enum json_bin_tag_t {
+    JSON_BIN_TAG_NONE,
+    JSON_BIN_TAG_NULL,
+    JSON_BIN_TAG_FALSE,
+    JSON_BIN_TAG_TRUE,
+    JSON_BIN_TAG_INT,
+    JSON_BIN_TAG_INT64,
+    JSON_BIN_TAG_UINT64,
+    JSON_BIN_TAG_INT64_RECORD,
+    JSON_BIN_TAG_UINT64_RECORD,
+    JSON_BIN_TAG_DOUBLE,
+    JSON_BIN_TAG_STRING,
+    JSON_BIN_TAG_ARRAY,
+    JSON_BIN_TAG_OBJECT,
+};
+
+
+struct json_bin_header_t {
+    char magic[4];
+    uint32_t order;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t root;
+};
+
+
+/* followed by the bytes and a '\0' */
+struct json_bin_string_t {
+    uint32_t len;
+    uint32_t size;
+};
+
+
+/* followed by count refs */
+struct json_bin_array_t {
+    uint64_t count;
+};
+
+
+struct json_bin_member_t {
+    uint64_t key;
+    json_bin_ref_t val;
+};
+
+
+/* followed by count members, then mask + 1 uint32_t of index if mask */
+struct json_bin_object_t {
+    uint64_t count;
+    uint64_t mask;
+};
+
+
+struct json_bin_frame_t {
+    const struct json_value_t *v;
+    size_t i;
+    uint64_t at;
+};
+
+
+struct json_bin_slot_t {
+    uint64_t hash;
+    uint64_t offset;
+};
+
+
+struct json_bin_encoder_t {
+    char *data;
+    size_t len;
+    size_t capacity;
+
+    /* plain strings already in the image */
+    struct json_bin_slot_t *strings;
+    size_t count;
+    size_t mask;
+
+    struct json_bin_frame_t *frames;
+    size_t depth;
+    size_t max_depth;
+};
+
+
+/* size bytes more, zeroed, 8-aligned; their offset or 0 */
+static uint64_t
+json_bin_reserve(struct json_bin_encoder_t *e, size_t size)
+{
+    size = (size + JSON_BIN_ALIGN - 1) & ~(size_t)(JSON_BIN_ALIGN - 1);
+
+    if (size > e->capacity - e->len) {
+        size_t capacity = e->capacity;
+
+        while (size > capacity - e->len) {
+            capacity *= 2;
+        }
+
+        char *data = realloc(e->data, capacity);
+        if (!data) {
+            return 0;
+        }
+
+        e->data = data;
+        e->capacity = capacity;
+    }
+
+    uint64_t offset = e->len;
+
+    memset(e->data + offset, 0, size);
+    e->len += size;
+
+    return offset;
+}
+
+
+static inline void *
+json_bin_at(struct json_bin_encoder_t *e, uint64_t offset)
+{
+    return e->data + offset;
+}
+
+
+static int
+json_bin_strings_grow(struct json_bin_encoder_t *e)
+{
+    size_t mask = e->mask ? e->mask * 2 + 1 : 1023;
+
+    struct json_bin_slot_t *strings = calloc(mask + 1, sizeof(struct json_bin_slot_t));
+    if (!strings) {
+        return -1;
+    }
+
+    for (size_t i = 0; i <= e->mask && e->strings; ++i) {
+        if (e->strings[i].offset) {
+            size_t slot = e->strings[i].hash & mask;
+
+            while (strings[slot].offset) {
+                slot = (slot + 1) & mask;
+            }
+
+            strings[slot] = e->strings[i];
+        }
+    }
+
+    free(e->strings);
+
+    e->strings = strings;
+    e->mask = mask;
+
+    return 0;
+}
+
+
+/* the record of str, shared with any equal string met before; 0 if out of memory */
+static uint64_t
+json_bin_string(struct json_bin_encoder_t *e, const struct json_string_t *str)
+{
+    if (str->len > JSON_BIN_STRING_MAX - 1) {
+        return 0;
+    }
+
+    if ((2 * e->count >= e->mask) && json_bin_strings_grow(e)) {
+        return 0;
+    }
+
+    uint64_t hash = json_string_hash(str);
+    size_t slot;
+
+    for (slot = hash & e->mask; e->strings[slot].offset; slot = (slot + 1) & e->mask) {
+        if (e->strings[slot].hash == hash) {
+            struct json_bin_string_t *s = json_bin_at(e, e->strings[slot].offset);
+
+            if ((s->len == str->len) && json_string_equal(str, (char *)(s + 1), s->len)) {
+                return e->strings[slot].offset;
+            }
+        }
+    }
+
+    uint64_t offset = json_bin_reserve(e, sizeof(struct json_bin_string_t) + str->len + 1);
+    if (!offset) {
+        return 0;
+    }
+
+    struct json_bin_string_t *s = json_bin_at(e, offset);
+    char *p = (char *)(s + 1);
+
+    json_strcpy(p, str, str->len);
+
+    s->len = (uint32_t)str->len;
+    s->size = (uint32_t)str->len;
+
+    if (json_string_is_plain(p, str->len)) {
+        e->strings[slot].hash = hash;
+        e->strings[slot].offset = offset;
+        ++e->count;
+
+        return offset;
+    }
+
+    size_t size = json_string_raw_size(str);
+
+    if (size > JSON_BIN_STRING_MAX - 1) {
+        return 0;
+    }
+
+    e->len = offset;
+
+    offset = json_bin_reserve(e, sizeof(struct json_bin_string_t) + size + 1);
+    if (!offset) {
+        return 0;
+    }
+
+    s = json_bin_at(e, offset);
+    s->len = (uint32_t)str->len;
+    s->size = (uint32_t)size;
+    memcpy(s + 1, str->data, size);
+
+    return offset;
+}
+
+
+static int
+json_bin_push(struct json_bin_encoder_t *e, const struct json_value_t *v, uint64_t at)
+{
+    if (e->depth == e->max_depth) {
+        size_t n = e->max_depth ? e->max_depth * 2 : 64;
+
+        struct json_bin_frame_t *frames = realloc(e->frames, n * sizeof(struct json_bin_frame_t));
+        if (!frames) {
+            return -1;
+        }
+
+        e->frames = frames;
+        e->max_depth = n;
+    }
+
+    struct json_bin_frame_t *f = &e->frames[e->depth++];
+
+    f->v = v;
+    f->i = 0;
+    f->at = at;
+
+    return 0;
+}
+
+
+/* the ref of v; a container gets its record, members left to fill, and a frame */
+static json_bin_ref_t
+json_bin_value(struct json_bin_encoder_t *e, const struct json_value_t *v)
+{
+    uint64_t offset;
+
+    switch (v->type) {
+    case JSON_VALUE_TYPE_NULL:
+        return JSON_BIN_REF(JSON_BIN_TAG_NULL, 0);
+    case JSON_VALUE_TYPE_BOOL:
+        return JSON_BIN_REF(v->b ? JSON_BIN_TAG_TRUE : JSON_BIN_TAG_FALSE, 0);
+    case JSON_VALUE_TYPE_INT:
+        return JSON_BIN_REF(JSON_BIN_TAG_INT, (int64_t)v->i);
+    case JSON_VALUE_TYPE_INT64:
+        if ((v->i64 >= JSON_BIN_INLINE_MIN) && (v->i64 <= JSON_BIN_INLINE_MAX)) {
+            return JSON_BIN_REF(JSON_BIN_TAG_INT64, v->i64);
+        }
+
+        if (!(offset = json_bin_reserve(e, sizeof(int64_t)))) {
+            return 0;
+        }
+
+        memcpy(json_bin_at(e, offset), &v->i64, sizeof(int64_t));
+
+        return JSON_BIN_REF(JSON_BIN_TAG_INT64_RECORD, offset);
+    case JSON_VALUE_TYPE_UINT64:
+        if (v->u64 <= (uint64_t)JSON_BIN_INLINE_MAX) {
+            return JSON_BIN_REF(JSON_BIN_TAG_UINT64, v->u64);
+        }
+
+        if (!(offset = json_bin_reserve(e, sizeof(uint64_t)))) {
+            return 0;
+        }
+
+        memcpy(json_bin_at(e, offset), &v->u64, sizeof(uint64_t));
+
+        return JSON_BIN_REF(JSON_BIN_TAG_UINT64_RECORD, offset);
+    case JSON_VALUE_TYPE_DOUBLE:
+        if (!(offset = json_bin_reserve(e, sizeof(double)))) {
+            return 0;
+        }
+
+        memcpy(json_bin_at(e, offset), &v->d, sizeof(double));
+
+        return JSON_BIN_REF(JSON_BIN_TAG_DOUBLE, offset);
+    case JSON_VALUE_TYPE_STRING:
+        offset = json_bin_string(e, &v->str);
+
+        return offset ? JSON_BIN_REF(JSON_BIN_TAG_STRING, offset) : 0;
+    case JSON_VALUE_TYPE_ARRAY:
+        offset = json_bin_reserve(e, sizeof(struct json_bin_array_t) + v->arr.size * sizeof(json_bin_ref_t));
+        if (!offset || json_bin_push(e, v, offset + sizeof(struct json_bin_array_t))) {
+            return 0;
+        }
+
+        ((struct json_bin_array_t *)json_bin_at(e, offset))->count = v->arr.size;
+
+        return JSON_BIN_REF(JSON_BIN_TAG_ARRAY, offset);
+    case JSON_VALUE_TYPE_OBJECT:
+        break;
+    default:
+        return 0;
+    }
+
+    size_t mask = 0;
+
+    if ((v->obj.size >= JSON_OBJECT_INDEX_THRESHOLD) && (v->obj.size < 0x7FFFFFFF)) {
+        for (mask = 2 * JSON_OBJECT_INDEX_THRESHOLD; mask < 2 * v->obj.size; mask *= 2) {
+        }
+
+        --mask;
+    }
+
+    size_t members = v->obj.size * sizeof(struct json_bin_member_t);
+
+    offset = json_bin_reserve(e, sizeof(struct json_bin_object_t) + members + (mask ? (mask + 1) * sizeof(uint32_t) : 0));
+    if (!offset || json_bin_push(e, v, offset + sizeof(struct json_bin_object_t))) {
+        return 0;
+    }
+
+    struct json_bin_object_t *o = json_bin_at(e, offset);
+
+    o->count = v->obj.size;
+    o->mask = mask;
+
+    if (mask) {
+        uint32_t *index = (uint32_t *)((char *)(o + 1) + members);
+
+        /* as json_object_index files them */
+        for (size_t i = 0; i < v->obj.size; ++i) {
+            size_t slot = json_string_hash(&v->obj.elts[i].key) & mask;
+
+            while (index[slot]) {
+                slot = (slot + 1) & mask;
+            }
+
+            index[slot] = (uint32_t)(i + 1);
+        }
+    }
+
+    return JSON_BIN_REF(JSON_BIN_TAG_OBJECT, offset);
+}
+
+
+/* depth first with a stack of frames, so records come out in document order */
+static int
+json_bin_tree(struct json_bin_encoder_t *e, const struct json_value_t *v, json_bin_ref_t *root)
+{
+    if (!(*root = json_bin_value(e, v))) {
+        return -1;
+    }
+
+    while (e->depth) {
+        struct json_bin_frame_t *f = &e->frames[e->depth - 1];
+        const struct json_value_t *c;
+        uint64_t at;
+
+        if (JSON_VALUE_TYPE_OBJECT == f->v->type) {
+            if (f->i == f->v->obj.size) {
+                --e->depth;
+                continue;
+            }
+
+            const struct json_object_elt_t *elt = &f->v->obj.elts[f->i];
+            uint64_t key = json_bin_string(e, &elt->key);
+
+            if (!key) {
+                return -1;
+            }
+
+            at = f->at + f->i * sizeof(struct json_bin_member_t);
+            ((struct json_bin_member_t *)json_bin_at(e, at))->key = key;
+
+            at += offsetof(struct json_bin_member_t, val);
+            c = &elt->val;
+        }
+        else {
+            if (f->i == f->v->arr.size) {
+                --e->depth;
+                continue;
+            }
+
+            at = f->at + f->i * sizeof(json_bin_ref_t);
+            c = &f->v->arr.elts[f->i];
+        }
+
+        ++f->i;
+
+        /* f goes stale here: the frames may move */
+        json_bin_ref_t ref = json_bin_value(e, c);
+
+        if (!ref) {
+            return -1;
+        }
+
+        memcpy(json_bin_at(e, at), &ref, sizeof ref);
+    }
+
+    return 0;
+}
+
+
+int
+json_bin_encode(const struct json_value_t *v, char **data, size_t *size)
+{
+    struct json_bin_encoder_t e;
+    json_bin_ref_t root;
+
+    memset(&e, 0, sizeof e);
+
+    e.capacity = 64 * 1024;
+    if (!(e.data = malloc(e.capacity))) {
+        return -1;
+    }
+
+    json_bin_reserve(&e, sizeof(struct json_bin_header_t));
+
+    int r = json_bin_tree(&e, v, &root);
+
+    free(e.strings);
+    free(e.frames);
+
+    if (r) {
+        free(e.data);
+        return -1;
+    }
+
+    struct json_bin_header_t *h = json_bin_at(&e, 0);
+
+    memcpy(h->magic, JSON_BIN_MAGIC, sizeof h->magic);
+    h->order = JSON_BIN_ORDER;
+    h->version = JSON_BIN_VERSION;
+    h->size = e.len;
+    h->root = root;
+
+    *data = e.data;
+    *size = e.len;
+
+    return 0;
+}
+
+
+int
+json_bin_open(struct json_bin_t *b, const void *data, size_t size)
+{
+    const struct json_bin_header_t *h = data;
+
+    if ((size < sizeof(struct json_bin_header_t)) || ((uintptr_t)data & (JSON_BIN_ALIGN - 1))
+        || memcmp(h->magic, JSON_BIN_MAGIC, sizeof h->magic) || (JSON_BIN_ORDER != h->order)
+        || (JSON_BIN_VERSION != h->version) || (h->size > size) || (h->size < sizeof(struct json_bin_header_t))
+        || (JSON_VALUE_TYPE_NONE == json_bin_type(h->root))) {
+        return -1;
+    }
+
+    b->data = data;
+    b->size = h->size;
+    b->root = h->root;
+
+    return 0;
+}
+
+
+/* the record of v if it has size bytes in the image */
+static inline const void *
+json_bin_record(const struct json_bin_t *b, json_bin_ref_t v, size_t size)
+{
+    uint64_t offset = JSON_BIN_OFFSET(v);
+
+    if ((offset & (JSON_BIN_ALIGN - 1)) || (offset > b->size) || (size > b->size - offset)) {
+        return NULL;
+    }
+
+    return b->data + offset;
+}
+
+
+/* the members of container v, NULL if it has none in the image */
+static inline const void *
+json_bin_members(const struct json_bin_t *b, json_bin_ref_t v, size_t *count)
+{
+    const uint64_t *p;
+    size_t header, width;
+
+    if (JSON_BIN_TAG_ARRAY == JSON_BIN_TAG(v)) {
+        header = sizeof(struct json_bin_array_t);
+        width = sizeof(json_bin_ref_t);
+    }
+    else if (JSON_BIN_TAG_OBJECT == JSON_BIN_TAG(v)) {
+        header = sizeof(struct json_bin_object_t);
+        width = sizeof(struct json_bin_member_t);
+    }
+    else {
+        return NULL;
+    }
+
+    if (!(p = json_bin_record(b, v, header)) || (*p > (b->size - JSON_BIN_OFFSET(v) - header) / width)) {
+        return NULL;
+    }
+
+    *count = *p;
+
+    return (const char *)p + header;
+}
+
+
+static int
+json_bin_string_at(const struct json_bin_t *b, uint64_t offset, struct json_string_t *str)
+{
+    const struct json_bin_string_t *s = json_bin_record(b, JSON_BIN_REF(0, offset), sizeof(struct json_bin_string_t));
+
+    if (!s || !json_bin_record(b, JSON_BIN_REF(0, offset), sizeof(struct json_bin_string_t) + (size_t)s->size + 1)) {
+        return -1;
+    }
+
+    str->data = (char *)(s + 1);
+    str->len = s->len;
+
+    return 0;
+}
+
+
+enum json_value_type_t
+json_bin_type(json_bin_ref_t v)
+{
+    switch (JSON_BIN_TAG(v)) {
+    case JSON_BIN_TAG_NULL:
+        return JSON_VALUE_TYPE_NULL;
+    case JSON_BIN_TAG_FALSE:
+    case JSON_BIN_TAG_TRUE:
+        return JSON_VALUE_TYPE_BOOL;
+    case JSON_BIN_TAG_INT:
+        return JSON_VALUE_TYPE_INT;
+    case JSON_BIN_TAG_INT64:
+    case JSON_BIN_TAG_INT64_RECORD:
+        return JSON_VALUE_TYPE_INT64;
+    case JSON_BIN_TAG_UINT64:
+    case JSON_BIN_TAG_UINT64_RECORD:
+        return JSON_VALUE_TYPE_UINT64;
+    case JSON_BIN_TAG_DOUBLE:
+        return JSON_VALUE_TYPE_DOUBLE;
+    case JSON_BIN_TAG_STRING:
+        return JSON_VALUE_TYPE_STRING;
+    case JSON_BIN_TAG_ARRAY:
+        return JSON_VALUE_TYPE_ARRAY;
+    case JSON_BIN_TAG_OBJECT:
+        return JSON_VALUE_TYPE_OBJECT;
+    default:
+        return JSON_VALUE_TYPE_NONE;
+    }
+}
+
+
+size_t
+json_bin_size(const struct json_bin_t *b, json_bin_ref_t v)
+{
+    size_t count;
+
+    return json_bin_members(b, v, &count) ? count : 0;
+}
+
+
+json_bin_ref_t
+json_bin_array_get(const struct json_bin_t *b, json_bin_ref_t v, size_t i)
+{
+    size_t count;
+    const json_bin_ref_t *elts;
+
+    if ((JSON_BIN_TAG_ARRAY != JSON_BIN_TAG(v)) || !(elts = json_bin_members(b, v, &count)) || (i >= count)) {
+        return 0;
+    }
+
+    return elts[i];
+}
+
+
+json_bin_ref_t
+json_bin_object_at(const struct json_bin_t *b, json_bin_ref_t v, size_t i, struct json_string_t *key)
+{
+    size_t count;
+    const struct json_bin_member_t *elts;
+
+    if ((JSON_BIN_TAG_OBJECT != JSON_BIN_TAG(v)) || !(elts = json_bin_members(b, v, &count)) || (i >= count)) {
+        return 0;
+    }
+
+    if (key && json_bin_string_at(b, elts[i].key, key)) {
+        return 0;
+    }
+
+    return elts[i].val;
+}
+
+
+json_bin_ref_t
+json_bin_object_get(const struct json_bin_t *b, json_bin_ref_t v, const char *key, size_t len)
+{
+    size_t count;
+    const struct json_bin_member_t *elts;
+    struct json_string_t k;
+
+    if ((JSON_BIN_TAG_OBJECT != JSON_BIN_TAG(v)) || !(elts = json_bin_members(b, v, &count))) {
+        return 0;
+    }
+
+    const struct json_bin_object_t *o = (const struct json_bin_object_t *)elts - 1;
+    size_t mask = o->mask;
+
+    if (!mask) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!json_bin_string_at(b, elts[i].key, &k) && json_string_equal(&k, key, len)) {
+                return elts[i].val;
+            }
+        }
+
+        return 0;
+    }
+
+    const uint32_t *index = (const uint32_t *)(elts + count);
+    size_t left = b->size - ((const char *)index - b->data);
+
+    if ((mask & (mask + 1)) || (mask >= left / sizeof(uint32_t))) {
+        return 0;
+    }
+
+    uint32_t i;
+
+    for (size_t slot = json_hash(key, len) & mask; (i = index[slot]) && (i <= count); slot = (slot + 1) & mask) {
+        if (!json_bin_string_at(b, elts[i - 1].key, &k) && json_string_equal(&k, key, len)) {
+            return elts[i - 1].val;
+        }
+    }
+
+    return 0;
+}
+
+
+int
+json_bin_get_string(const struct json_bin_t *b, json_bin_ref_t v, struct json_string_t *str)
+{
+    if ((JSON_BIN_TAG_STRING != JSON_BIN_TAG(v)) || json_bin_string_at(b, JSON_BIN_OFFSET(v), str)) {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+/* the 8 bytes of a number record */
+static inline int
+json_bin_number(const struct json_bin_t *b, json_bin_ref_t v, void *x)
+{
+    const void *p = json_bin_record(b, v, 8);
+
+    if (!p) {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    memcpy(x, p, 8);
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_bin_get_int64(const struct json_bin_t *b, json_bin_ref_t v, int64_t *i)
+{
+    uint64_t u;
+
+    switch (JSON_BIN_TAG(v)) {
+    case JSON_BIN_TAG_INT:
+    case JSON_BIN_TAG_INT64:
+    case JSON_BIN_TAG_UINT64:
+        *i = JSON_BIN_INLINE(v);
+        return JSON_PARSER_ERROR_OK;
+    case JSON_BIN_TAG_INT64_RECORD:
+        return json_bin_number(b, v, i);
+    case JSON_BIN_TAG_UINT64_RECORD:
+        if (json_bin_number(b, v, &u)) {
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+        }
+
+        if (u > INT64_MAX) {
+            return JSON_PARSER_ERROR_NUMBER_TOO_BIG;
+        }
+
+        *i = (int64_t)u;
+        return JSON_PARSER_ERROR_OK;
+    default:
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+}
+
+
+int
+json_bin_get_uint64(const struct json_bin_t *b, json_bin_ref_t v, uint64_t *u)
+{
+    int64_t i;
+
+    switch (JSON_BIN_TAG(v)) {
+    case JSON_BIN_TAG_UINT64_RECORD:
+        return json_bin_number(b, v, u);
+    case JSON_BIN_TAG_INT64_RECORD:
+        if (json_bin_number(b, v, &i)) {
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+        }
+        break;
+    case JSON_BIN_TAG_INT:
+    case JSON_BIN_TAG_INT64:
+    case JSON_BIN_TAG_UINT64:
+        i = JSON_BIN_INLINE(v);
+        break;
+    default:
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    if (i < 0) {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    *u = (uint64_t)i;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_bin_get_double(const struct json_bin_t *b, json_bin_ref_t v, double *d)
+{
+    int64_t i;
+    uint64_t u;
+
+    switch (JSON_BIN_TAG(v)) {
+    case JSON_BIN_TAG_DOUBLE:
+        return json_bin_number(b, v, d);
+    case JSON_BIN_TAG_UINT64_RECORD:
+        if (json_bin_number(b, v, &u)) {
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+        }
+
+        *d = (double)u;
+        return JSON_PARSER_ERROR_OK;
+    default:
+        if (json_bin_get_int64(b, v, &i)) {
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+        }
+
+        *d = (double)i;
+        return JSON_PARSER_ERROR_OK;
+    }
+}
+
+
+int
+json_bin_get_bool(json_bin_ref_t v, int *b)
+{
+    if ((JSON_BIN_TAG_FALSE != JSON_BIN_TAG(v)) && (JSON_BIN_TAG_TRUE != JSON_BIN_TAG(v))) {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    *b = (JSON_BIN_TAG_TRUE == JSON_BIN_TAG(v));
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+struct json_bin_decode_frame_t {
+    struct json_value_t *v;
+    const void *elts;
+    size_t count;
+};
+
+
+/* v as the ref says, its members allocated but still to fill; -1 if out of memory or no image */
+static int
+json_bin_decode_value(struct json_allocator_t *a, const struct json_bin_t *b, json_bin_ref_t ref,
+                      struct json_value_t *v, struct json_bin_decode_frame_t *f)
+{
+    f->elts = NULL;
+    f->count = 0;
+
+    switch ((v->type = json_bin_type(ref))) {
+    case JSON_VALUE_TYPE_NULL:
+        return 0;
+    case JSON_VALUE_TYPE_BOOL:
+        v->b = (JSON_BIN_TAG_TRUE == JSON_BIN_TAG(ref));
+        return 0;
+    case JSON_VALUE_TYPE_INT:
+        v->i = (int)JSON_BIN_INLINE(ref);
+        return 0;
+    case JSON_VALUE_TYPE_INT64:
+        return json_bin_get_int64(b, ref, &v->i64) ? -1 : 0;
+    case JSON_VALUE_TYPE_UINT64:
+        return json_bin_get_uint64(b, ref, &v->u64) ? -1 : 0;
+    case JSON_VALUE_TYPE_DOUBLE:
+        return json_bin_get_double(b, ref, &v->d) ? -1 : 0;
+    case JSON_VALUE_TYPE_STRING:
+        return json_bin_get_string(b, ref, &v->str) ? -1 : 0;
+    case JSON_VALUE_TYPE_ARRAY:
+        v->arr.elts = NULL;
+        v->arr.size = v->arr.capacity = 0;
+
+        if (!(f->elts = json_bin_members(b, ref, &f->count))) {
+            return -1;
+        }
+
+        if (f->count && !(v->arr.elts = a->vtbl->on_alloc(a->ctx, f->count * sizeof(struct json_value_t)))) {
+            return -1;
+        }
+
+        v->arr.capacity = f->count;
+        break;
+    case JSON_VALUE_TYPE_OBJECT:
+        v->obj.elts = NULL;
+        v->obj.size = v->obj.capacity = 0;
+        v->obj.index = NULL;
+
+        if (!(f->elts = json_bin_members(b, ref, &f->count))) {
+            return -1;
+        }
+
+        if (f->count && !(v->obj.elts = a->vtbl->on_alloc(a->ctx, f->count * sizeof(struct json_object_elt_t)))) {
+            return -1;
+        }
+
+        v->obj.capacity = f->count;
+        break;
+    default:
+        return -1;
+    }
+
+    f->v = v;
+
+    return 0;
+}
+
+
+/*
+ * depth first as json_bin_tree writes it, with a frame per level; a
+ * container counts a member only once it is set, so json_value_free can
+ * take back a tree left half done.
+ */
+struct json_value_t *
+json_bin_decode(struct json_allocator_t *a, const struct json_bin_t *b, json_bin_ref_t v)
+{
+    struct json_bin_decode_frame_t *frames = NULL;
+    size_t depth = 0, max_depth = 0;
+    struct json_bin_decode_frame_t f;
+
+    struct json_value_t *root = a->vtbl->on_alloc(a->ctx, sizeof(struct json_value_t));
+    if (!root) {
+        return NULL;
+    }
+
+    root->parent = NULL;
+
+    if (json_bin_decode_value(a, b, v, root, &f)) {
+        goto failed;
+    }
+
+    while (1) {
+        if (f.elts) {
+            if (depth == max_depth) {
+                size_t n = max_depth ? max_depth * 2 : 64;
+
+                struct json_bin_decode_frame_t *p = realloc(frames, n * sizeof(struct json_bin_decode_frame_t));
+                if (!p) {
+                    goto failed;
+                }
+
+                frames = p;
+                max_depth = n;
+            }
+
+            frames[depth++] = f;
+        }
+
+        if (!depth) {
+            break;
+        }
+
+        struct json_bin_decode_frame_t *top = &frames[depth - 1];
+        struct json_value_t *p = top->v;
+        struct json_value_t *c;
+        json_bin_ref_t ref;
+
+        if (JSON_VALUE_TYPE_OBJECT == p->type) {
+            if (p->obj.size == top->count) {
+                --depth;
+                f.elts = NULL;
+
+                if (json_object_index(a, p)) {
+                    goto failed;
+                }
+
+                continue;
+            }
+
+            const struct json_bin_member_t *m = (const struct json_bin_member_t *)top->elts + p->obj.size;
+            struct json_object_elt_t *elt = &p->obj.elts[p->obj.size];
+
+            if (json_bin_string_at(b, m->key, &elt->key)) {
+                goto failed;
+            }
+
+            ref = m->val;
+            c = &elt->val;
+        }
+        else {
+            if (p->arr.size == top->count) {
+                --depth;
+                f.elts = NULL;
+                continue;
+            }
+
+            ref = ((const json_bin_ref_t *)top->elts)[p->arr.size];
+            c = &p->arr.elts[p->arr.size];
+        }
+
+        c->parent = p;
+
+        int r = json_bin_decode_value(a, b, ref, c, &f);
+
+        /* counted even when it failed: a container c holds no members yet, anything else nothing to free */
+        if (JSON_VALUE_TYPE_OBJECT == p->type) {
+            ++p->obj.size;
+        }
+        else {
+            ++p->arr.size;
+        }
+
+        if (r) {
+            goto failed;
+        }
+    }
+
+    free(frames);
+
+    return root;
+
+failed:
+
+    free(frames);
+    json_value_free(a, root, 0);
+
+    return NULL;
+}
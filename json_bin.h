@@ -0,0 +1,85 @@
+#ifndef _JSON_BIN_H_INCLUDED
+#define _JSON_BIN_H_INCLUDED
+
+#include "json_parser.h"
+
+
+#define JSON_BIN_VERSION            1
+
+
+/*
+ * a json_value_t tree as one flat image that is read in place: every
+ * link is an offset from the start of the image, so it works wherever
+ * it ends up, straight out of mmap included, with nothing to decode or
+ * allocate before use.
+ *
+ * a value is a 64-bit ref: the low 4 bits a tag, the rest either the
+ * value itself (null, bool, ints that fit) or the offset of its record
+ * (other numbers, strings, arrays, objects). records are 8-aligned,
+ * containers in document order behind their parent. strings are kept
+ * once per image, unescaped unless that would need escapes again, so
+ * they come out as any json_string_t of the library does; objects of
+ * JSON_OBJECT_INDEX_THRESHOLD members or more carry their hash index.
+ *
+ * images are native byte order; json_bin_open refuses one from a host
+ * of the other order or another JSON_BIN_VERSION. it checks the header
+ * only: the readers keep offsets inside the image but take the records
+ * for what json_bin_encode wrote, so an image that may have been
+ * tampered with wants a text parse instead.
+ */
+typedef uint64_t json_bin_ref_t;
+
+struct json_bin_t {
+    const char *data;
+    size_t size;
+    json_bin_ref_t root;
+};
+
+
+/* *data is malloc'ed, the caller frees it; -1 if out of memory or v too big */
+int json_bin_encode(const struct json_value_t *v, char **data, size_t *size);
+
+/* data has to stay mapped, and 8-aligned, while b is used; -1 if it is no image */
+int json_bin_open(struct json_bin_t *b, const void *data, size_t size);
+
+/*
+ * the tree of v (json_bin_root for all of it) through a's allocator,
+ * strings pointing into the image; NULL if out of memory. free it with
+ * json_value_free.
+ */
+struct json_value_t *json_bin_decode(struct json_allocator_t *a, const struct json_bin_t *b, json_bin_ref_t v);
+
+
+static inline json_bin_ref_t
+json_bin_root(const struct json_bin_t *b)
+{
+    return b->root;
+}
+
+
+/* JSON_VALUE_TYPE_NONE for the 0 ref the lookups give when there is nothing */
+enum json_value_type_t json_bin_type(json_bin_ref_t v);
+
+/* members of an array or object, 0 for anything else */
+size_t json_bin_size(const struct json_bin_t *b, json_bin_ref_t v);
+
+json_bin_ref_t json_bin_array_get(const struct json_bin_t *b, json_bin_ref_t v, size_t i);
+
+/* key may be NULL */
+json_bin_ref_t json_bin_object_at(const struct json_bin_t *b, json_bin_ref_t v, size_t i, struct json_string_t *key);
+
+json_bin_ref_t json_bin_object_get(const struct json_bin_t *b, json_bin_ref_t v, const char *key, size_t len);
+
+/* the getters return a JSON_PARSER_ERROR_* code, as the cursor's do */
+int json_bin_get_string(const struct json_bin_t *b, json_bin_ref_t v, struct json_string_t *str);
+
+int json_bin_get_int64(const struct json_bin_t *b, json_bin_ref_t v, int64_t *i);
+
+int json_bin_get_uint64(const struct json_bin_t *b, json_bin_ref_t v, uint64_t *u);
+
+int json_bin_get_double(const struct json_bin_t *b, json_bin_ref_t v, double *d);
+
+int json_bin_get_bool(json_bin_ref_t v, int *b);
+
+
+#endif //_JSON_BIN_H_INCLUDED
@@ -0,0 +1,55 @@
+#include "json_bind.h"
+
+
+#define JSON_BIND_SEED_TRIES        4096
+
+
+static int
+json_bind_try_seed(struct json_bind_t *b, uint32_t seed)
+{
+    memset(b->slots, 0, sizeof b->slots);
+
+    for (size_t i = 0; i < b->count; ++i) {
+        uint32_t h = json_bind_hash(seed, b->fields[i].key, b->fields[i].len);
+
+        if (b->slots[h]) {
+            return -1;
+        }
+
+        b->slots[h] = (uint8_t)(i + 1);
+    }
+
+    return 0;
+}
+
+
+void
+json_bind_prepare(struct json_bind_t *b)
+{
+    uint32_t seed = 0x9E3779B1;
+
+    b->seed = 0;
+
+    for (size_t i = 0; i < b->count; ++i) {
+        if (b->fields[i].bind) {
+            json_bind_prepare(b->fields[i].bind);
+        }
+    }
+
+    if (!b->count || (b->count > JSON_BIND_SLOTS / 2)) {
+        return;
+    }
+
+    for (int i = 0; i < JSON_BIND_SEED_TRIES; ++i) {
+        if (!json_bind_try_seed(b, seed)) {
+            b->seed = seed;
+            return;
+        }
+
+        /* odd multipliers only */
+        seed = seed * 0x2C1B3C6D + 0x297A2D39;
+        seed |= 1;
+    }
+
+    memset(b->slots, 0, sizeof b->slots);
+}
@@ -0,0 +1,153 @@
+#ifndef _JSON_BIND_H_INCLUDED
+#define _JSON_BIND_H_INCLUDED
+
+#include <stddef.h>
+#include <string.h>
+#include "json_parser.h"
+
+
+#define JSON_BIND_SLOTS             64
+
+
+/*
+ * the C type a bound field has: BOOL and INT are int, INT64 int64_t,
+ * UINT64 uint64_t, DOUBLE double, STRING a struct json_string_t (into
+ * the input, escapes left in like DOM strings), OBJECT a struct
+ * described by its own json_bind_t.
+ */
+enum json_bind_type_t {
+    JSON_BIND_TYPE_BOOL,
+    JSON_BIND_TYPE_INT,
+    JSON_BIND_TYPE_INT64,
+    JSON_BIND_TYPE_UINT64,
+    JSON_BIND_TYPE_DOUBLE,
+    JSON_BIND_TYPE_STRING,
+    JSON_BIND_TYPE_OBJECT,
+};
+
+
+/*
+ * an array field holds up to capacity elements of type at offset and
+ * their number, a size_t, at count. bind, the descriptor of an OBJECT
+ * field, is not const: json_bind_prepare writes to it as well.
+ */
+struct json_bind_field_t {
+    const char *key;
+    size_t len;
+
+    enum json_bind_type_t type;
+    size_t offset;
+    struct json_bind_t *bind;
+
+    size_t capacity;
+    size_t count;
+};
+
+
+/*
+ * a struct and the members the document's keys go to. seed and slots
+ * hold the perfect hash json_bind_prepare finds for the keys; without
+ * one (seed 0) keys are looked up by length and memcmp.
+ */
+struct json_bind_t {
+    const struct json_bind_field_t *fields;
+    size_t count;
+    size_t size;
+
+    uint32_t seed;
+    uint8_t slots[JSON_BIND_SLOTS];
+};
+
+
+#define JSON_BIND_MEMBER_SIZE(st, member)   sizeof(((st *)0)->member)
+
+
+#define JSON_BIND_KEY(key, st, member, type)                        \
+    { key, sizeof(key) - 1, JSON_BIND_TYPE_##type, offsetof(st, member), NULL, 0, 0 }
+
+#define JSON_BIND_FIELD(st, member, type)                           \
+    JSON_BIND_KEY(#member, st, member, type)
+
+#define JSON_BIND_OBJECT(st, member, b)                             \
+    { #member, sizeof(#member) - 1, JSON_BIND_TYPE_OBJECT, offsetof(st, member), &(b), 0, 0 }
+
+#define JSON_BIND_ARRAY(st, member, type, count_member)             \
+    { #member, sizeof(#member) - 1, JSON_BIND_TYPE_##type, offsetof(st, member), NULL,   \
+      JSON_BIND_MEMBER_SIZE(st, member) / JSON_BIND_MEMBER_SIZE(st, member[0]),         \
+      offsetof(st, count_member) }
+
+#define JSON_BIND_OBJECT_ARRAY(st, member, b, count_member)         \
+    { #member, sizeof(#member) - 1, JSON_BIND_TYPE_OBJECT, offsetof(st, member), &(b),  \
+      JSON_BIND_MEMBER_SIZE(st, member) / JSON_BIND_MEMBER_SIZE(st, member[0]),         \
+      offsetof(st, count_member) }
+
+#define JSON_BIND(st, fields)                                       \
+    { fields, sizeof(fields) / sizeof((fields)[0]), sizeof(st), 0, { 0 } }
+
+
+static inline uint32_t
+json_bind_hash(uint32_t seed, const char *key, size_t len)
+{
+    uint32_t h = (uint32_t)len;
+
+    if (len) {
+        h = (h << 16) ^ ((uint32_t)(unsigned char)key[0] << 8) ^ (unsigned char)key[len - 1];
+
+        if (len > 2) {
+            h ^= (uint32_t)(unsigned char)key[len / 2] << 24;
+        }
+    }
+
+    return (h * seed) >> 26;
+}
+
+
+/* the field key (escapes and all, raw bytes of it, len once unescaped) goes to, NULL if none */
+static inline const struct json_bind_field_t *
+json_bind_find(const struct json_bind_t *b, const char *key, size_t raw, size_t len)
+{
+    const struct json_bind_field_t *f;
+
+    if (b->seed && (raw == len)) {
+        uint8_t slot = b->slots[json_bind_hash(b->seed, key, len)];
+
+        if (!slot) {
+            return NULL;
+        }
+
+        f = &b->fields[slot - 1];
+
+        return ((f->len == len) && !memcmp(f->key, key, len)) ? f : NULL;
+    }
+
+    struct json_string_t str = { (char *)key, len };
+
+    for (f = b->fields; f < b->fields + b->count; ++f) {
+        if ((f->len == len) && json_string_equal(&str, f->key, len)) {
+            return f;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * finds the key hash of b and of the structs it nests, and stores it in
+ * them: none of them can be const, and preparing has to be done before
+ * any json_bind_str that uses one of them may run concurrently. optional,
+ * lookups work without.
+ */
+void json_bind_prepare(struct json_bind_t *b);
+
+/*
+ * parses str straight into the struct at out, zeroed first. keys b does
+ * not bind are skipped unread, like json_read_path skips; null leaves a
+ * field zero. a value the field cannot hold (wrong type, integer out of
+ * range, more elements than the array has room for) fails with
+ * JSON_PARSER_ERROR_BIND_MISMATCH.
+ */
+int json_bind_str(const char *str, size_t len, const struct json_bind_t *b, void *out);
+
+
+#endif //_JSON_BIND_H_INCLUDED
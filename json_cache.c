@@ -0,0 +1,378 @@
+#include "json_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/random.h>
+
+
+#define JSON_CACHE_BUCKETS          64
+
+/* the xxh64 primes and round */
+#define JSON_CACHE_P1               UINT64_C(0x9E3779B185EBCA87)
+#define JSON_CACHE_P2               UINT64_C(0xC2B2AE3D27D4EB4F)
+#define JSON_CACHE_P3               UINT64_C(0x165667B19E3779F9)
+#define JSON_CACHE_P4               UINT64_C(0x85EBCA77C2B2AE63)
+
+#define JSON_CACHE_ROTL(x, r)       (((x) << (r)) | ((x) >> (64 - (r))))
+
+
+static inline uint64_t
+json_cache_round(uint64_t acc, uint64_t w)
+{
+    acc += w * JSON_CACHE_P2;
+    acc = JSON_CACHE_ROTL(acc, 31);
+
+    return acc * JSON_CACHE_P1;
+}
+
+
+static inline uint64_t
+json_cache_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= JSON_CACHE_P2;
+    h ^= h >> 29;
+    h *= JSON_CACHE_P3;
+
+    return h ^ (h >> 32);
+}
+
+
+/* four lanes of 8 bytes, seeded as xxh64 does and folded two ways into 128 bits */
+static void
+json_cache_hash(const uint64_t seed[2], const char *s, size_t len, uint64_t h[2])
+{
+    uint64_t v[4] = { seed[0] + JSON_CACHE_P1 + JSON_CACHE_P2, seed[0] + JSON_CACHE_P2,
+                      seed[1], seed[1] - JSON_CACHE_P1 };
+    uint64_t w[4];
+    size_t n = len;
+
+    for (; n >= sizeof w; s += sizeof w, n -= sizeof w) {
+        memcpy(w, s, sizeof w);
+
+        for (int i = 0; i < 4; ++i) {
+            v[i] = json_cache_round(v[i], w[i]);
+        }
+    }
+
+    if (n) {
+        memset(w, 0, sizeof w);
+        memcpy(w, s, n);
+
+        for (int i = 0; i < 4; ++i) {
+            v[i] = json_cache_round(v[i], w[i]);
+        }
+    }
+
+    h[0] = json_cache_avalanche(JSON_CACHE_ROTL(v[0], 1) + JSON_CACHE_ROTL(v[1], 7)
+                                + JSON_CACHE_ROTL(v[2], 12) + JSON_CACHE_ROTL(v[3], 18) + len);
+
+    h[1] = json_cache_avalanche((v[0] * JSON_CACHE_P3) ^ JSON_CACHE_ROTL(v[1], 17)
+                                ^ (v[2] * JSON_CACHE_P4) ^ JSON_CACHE_ROTL(v[3], 41) ^ (len * JSON_CACHE_P1));
+}
+
+
+int
+json_cache_init(struct json_cache_t *cache, size_t budget)
+{
+    memset(cache, 0, sizeof *cache);
+
+    cache->budget = budget ? budget : JSON_CACHE_BUDGET;
+    cache->mask = JSON_CACHE_BUCKETS - 1;
+
+    /* hits compare the bytes either way; a guessable secret only lets bucket chains be flooded */
+    if (getrandom(cache->seed, sizeof cache->seed, GRND_NONBLOCK) != (ssize_t)sizeof cache->seed) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        cache->seed[0] = json_cache_avalanche((uint64_t)ts.tv_nsec ^ ((uint64_t)ts.tv_sec << 32));
+        cache->seed[1] = json_cache_avalanche((uintptr_t)cache ^ cache->seed[0]);
+    }
+
+    if (!(cache->buckets = calloc(JSON_CACHE_BUCKETS, sizeof(struct json_cache_doc_t *)))) {
+        return -1;
+    }
+
+    if (pthread_mutex_init(&cache->lock, NULL)) {
+        free(cache->buckets);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void
+json_cache_free(struct json_cache_t *cache)
+{
+    struct json_cache_doc_t *d = cache->hand;
+
+    while (d) {
+        struct json_cache_doc_t *next = d->clock_next;
+
+        free((void *)d->bin.data);
+        d = (next == cache->hand) ? NULL : next;
+    }
+
+    free(cache->buckets);
+    pthread_mutex_destroy(&cache->lock);
+
+    cache->buckets = NULL;
+    cache->hand = NULL;
+}
+
+
+/* the document of exactly the bytes of str */
+static struct json_cache_doc_t *
+json_cache_lookup(struct json_cache_t *cache, const uint64_t hash[2], const char *str, size_t len)
+{
+    struct json_cache_doc_t *d = cache->buckets[hash[0] & cache->mask];
+
+    for (; d; d = d->next) {
+        if ((d->hash[0] == hash[0]) && (d->hash[1] == hash[1]) && (d->len == len) && !memcmp(d + 1, str, len)) {
+            return d;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* twice the buckets; stays as it is if out of memory, only slower */
+static void
+json_cache_grow(struct json_cache_t *cache)
+{
+    size_t mask = cache->mask * 2 + 1;
+
+    struct json_cache_doc_t **buckets = calloc(mask + 1, sizeof(struct json_cache_doc_t *));
+    if (!buckets) {
+        return;
+    }
+
+    for (size_t i = 0; i <= cache->mask; ++i) {
+        struct json_cache_doc_t *d = cache->buckets[i];
+
+        while (d) {
+            struct json_cache_doc_t *next = d->next;
+
+            d->next = buckets[d->hash[0] & mask];
+            buckets[d->hash[0] & mask] = d;
+            d = next;
+        }
+    }
+
+    free(cache->buckets);
+
+    cache->buckets = buckets;
+    cache->mask = mask;
+}
+
+
+static void
+json_cache_unlink(struct json_cache_t *cache, struct json_cache_doc_t *doc)
+{
+    struct json_cache_doc_t **p = &cache->buckets[doc->hash[0] & cache->mask];
+
+    while (*p != doc) {
+        p = &(*p)->next;
+    }
+
+    *p = doc->next;
+
+    if (doc->clock_next == doc) {
+        cache->hand = NULL;
+    }
+    else {
+        doc->clock_prev->clock_next = doc->clock_next;
+        doc->clock_next->clock_prev = doc->clock_prev;
+
+        if (cache->hand == doc) {
+            cache->hand = doc->clock_next;
+        }
+    }
+
+    doc->cached = 0;
+
+    --cache->stats.docs;
+    cache->stats.bytes -= doc->size;
+}
+
+
+/* CLOCK: the hand gives a document used since it last came by a second chance */
+static void
+json_cache_evict(struct json_cache_t *cache, size_t size)
+{
+    while (cache->hand && (size > cache->budget - cache->stats.bytes)) {
+        struct json_cache_doc_t *d = cache->hand;
+
+        if (d->referenced) {
+            d->referenced = 0;
+            cache->hand = d->clock_next;
+            continue;
+        }
+
+        json_cache_unlink(cache, d);
+        ++cache->stats.evictions;
+
+        if (!d->refs) {
+            free((void *)d->bin.data);
+        }
+    }
+}
+
+
+/* new documents go right behind the hand, the last it comes to */
+static void
+json_cache_insert(struct json_cache_t *cache, struct json_cache_doc_t *doc)
+{
+    json_cache_evict(cache, doc->size);
+
+    if (cache->stats.docs > cache->mask) {
+        json_cache_grow(cache);
+    }
+
+    struct json_cache_doc_t **bucket = &cache->buckets[doc->hash[0] & cache->mask];
+
+    doc->next = *bucket;
+    *bucket = doc;
+
+    if (!cache->hand) {
+        doc->clock_prev = doc->clock_next = doc;
+        cache->hand = doc;
+    }
+    else {
+        doc->clock_next = cache->hand;
+        doc->clock_prev = cache->hand->clock_prev;
+        doc->clock_prev->clock_next = doc;
+        cache->hand->clock_prev = doc;
+    }
+
+    doc->cached = 1;
+
+    ++cache->stats.docs;
+    cache->stats.bytes += doc->size;
+}
+
+
+/* the parser's tree as an image with the document and the input behind it, one allocation */
+static int
+json_cache_build(struct json_parser_t *parser, const uint64_t hash[2], const char *str, size_t len,
+                 struct json_cache_doc_t **doc)
+{
+    char *data;
+    size_t size;
+
+    if (json_bin_encode(parser->root, &data, &size)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    size_t at = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+    char *p = realloc(data, at + sizeof(struct json_cache_doc_t) + len);
+    if (!p) {
+        free(data);
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    struct json_cache_doc_t *d = (struct json_cache_doc_t *)(p + at);
+
+    json_bin_open(&d->bin, p, size);
+
+    d->hash[0] = hash[0];
+    d->hash[1] = hash[1];
+    d->len = len;
+    d->size = at + sizeof(struct json_cache_doc_t) + len;
+
+    memcpy(d + 1, str, len);
+
+    d->refs = 1;
+    d->referenced = 0;
+    d->cached = 0;
+
+    *doc = d;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_cache_parse(struct json_cache_t *cache, struct json_parser_t *parser, const char *str, size_t len,
+                 struct json_cache_doc_t **doc)
+{
+    struct json_cache_doc_t *d;
+    uint64_t hash[2];
+
+    json_cache_hash(cache->seed, str, len, hash);
+
+    pthread_mutex_lock(&cache->lock);
+
+    if ((d = json_cache_lookup(cache, hash, str, len))) {
+        ++d->refs;
+        d->referenced = 1;
+        ++cache->stats.hits;
+    }
+    else {
+        ++cache->stats.misses;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    if (d) {
+        *doc = d;
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    /* parsed outside the lock: another thread may be at the same input */
+    int r = json_parse_str(parser, str, len);
+
+    if (r || (r = json_cache_build(parser, hash, str, len, &d))) {
+        return r;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+
+    struct json_cache_doc_t *other = json_cache_lookup(cache, hash, str, len);
+
+    if (other) {
+        ++other->refs;
+        other->referenced = 1;
+    }
+    else if (d->size <= cache->budget) {
+        json_cache_insert(cache, d);
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    if (other) {
+        free((void *)d->bin.data);
+        d = other;
+    }
+
+    *doc = d;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+void
+json_cache_release(struct json_cache_t *cache, struct json_cache_doc_t *doc)
+{
+    pthread_mutex_lock(&cache->lock);
+
+    int last = !--doc->refs && !doc->cached;
+
+    pthread_mutex_unlock(&cache->lock);
+
+    if (last) {
+        free((void *)doc->bin.data);
+    }
+}
+
+
+void
+json_cache_stats(struct json_cache_t *cache, struct json_cache_stats_t *stats)
+{
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
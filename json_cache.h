@@ -0,0 +1,95 @@
+#ifndef _JSON_CACHE_H_INCLUDED
+#define _JSON_CACHE_H_INCLUDED
+
+#include <pthread.h>
+#include "json_bin.h"
+
+
+#define JSON_CACHE_BUDGET           (64 * 1024 * 1024)
+
+
+/*
+ * a document the cache handed out: read it through bin, which stays
+ * valid and unchanged until the json_cache_release that matches the
+ * json_cache_parse. the rest is the cache's; the input it was parsed
+ * from follows the struct, len bytes.
+ */
+struct json_cache_doc_t {
+    struct json_bin_t bin;
+
+    uint64_t hash[2];
+    size_t len;
+    size_t size;
+
+    size_t refs;
+    int referenced;
+    int cached;
+
+    struct json_cache_doc_t *next;
+    struct json_cache_doc_t *clock_prev;
+    struct json_cache_doc_t *clock_next;
+};
+
+
+struct json_cache_stats_t {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    /* what the cache holds now: documents and their bytes */
+    size_t docs;
+    size_t bytes;
+};
+
+
+/*
+ * parsed documents by the content of their input: the same bytes parsed
+ * again are a lookup that hands out the document built the first time.
+ * documents are json_bin images, each one allocation together with a
+ * copy of its input, kept within budget bytes, copies counted, and
+ * evicted CLOCK-wise; one evicted while still held goes away on its
+ * last release. a hit is an input of the same bytes: the hash, keyed
+ * with a secret of the cache's own, only finds the candidates, and the
+ * copy is compared to the input every time, so no client can have its
+ * document handed out for another's input.
+ *
+ * any number of threads may use a cache at once, each with its own
+ * parser.
+ */
+struct json_cache_t {
+    pthread_mutex_t lock;
+
+    struct json_cache_doc_t **buckets;
+    size_t mask;
+
+    struct json_cache_doc_t *hand;
+
+    /* keys the hash */
+    uint64_t seed[2];
+
+    size_t budget;
+    struct json_cache_stats_t stats;
+};
+
+
+/* budget 0: JSON_CACHE_BUDGET */
+int json_cache_init(struct json_cache_t *cache, size_t budget);
+
+/* every document is to be released before */
+void json_cache_free(struct json_cache_t *cache);
+
+/*
+ * the document of str, from the cache or parsed with parser, which is
+ * left holding the tree of a miss; a JSON_PARSER_ERROR_* code. errors
+ * are not cached. a document that does not fit the budget is handed out
+ * all the same, and not kept.
+ */
+int json_cache_parse(struct json_cache_t *cache, struct json_parser_t *parser, const char *str, size_t len,
+                     struct json_cache_doc_t **doc);
+
+void json_cache_release(struct json_cache_t *cache, struct json_cache_doc_t *doc);
+
+void json_cache_stats(struct json_cache_t *cache, struct json_cache_stats_t *stats);
+
+
+#endif //_JSON_CACHE_H_INCLUDED
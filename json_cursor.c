@@ -0,0 +1,721 @@
+#include "json_cursor.h"
+#include "json_number.h"
+#include "json_utf8.h"
+#include <string.h>
+
+
+#define JSON_CURSOR_IS_OBJECT(c, depth)                             \
+    (((c)->objects[(depth) / 64] >> ((depth) % 64)) & 1)
+
+
+struct json_cursor_scalar_t {
+    enum json_value_type_t type;
+
+    union {
+        int b;
+        int64_t i64;
+        uint64_t u64;
+        double d;
+    };
+};
+
+
+static inline void
+json_cursor_skip_ws(struct json_cursor_t *c)
+{
+    if ((c->src < c->tail) && JSON_PARSER_IS_WS(*c->src)) {
+        c->src = c->simd->skip_ws(c->src + 1, c->tail);
+    }
+}
+
+
+static inline int
+json_cursor_fail(struct json_cursor_t *c, int error)
+{
+    if (!c->error) {
+        c->error = error;
+    }
+
+    return c->error;
+}
+
+
+/* p is past the opening quote; returns past the closing one, NULL if there is none */
+static inline const char *
+json_cursor_skip_string(const struct json_cursor_t *c, const char *p)
+{
+    while ((p = c->simd->scan_string(p, c->tail)) < c->tail) {
+        if ('"' == *p) {
+            return p + 1;
+        }
+
+        if (c->tail - p < 2) {
+            break;
+        }
+
+        p += 2;
+    }
+
+    return NULL;
+}
+
+
+static const char *
+json_cursor_skip_scalar(const struct json_cursor_t *c, const char *p)
+{
+    while ((p < c->tail) && !JSON_PARSER_IS_WS(*p)
+           && (',' != *p) && (']' != *p) && ('}' != *p) && (':' != *p)) {
+        ++p;
+    }
+
+    return p;
+}
+
+
+/* reads the string at src, escapes checked, and moves past it */
+static int
+json_cursor_string(struct json_cursor_t *c, struct json_string_t *str)
+{
+    const char *p = c->src + 1;
+    size_t len = 0;
+
+    str->data = (char *)p;
+
+    while (1) {
+        const char *q = c->simd->scan_string(p, c->tail);
+
+        len += q - p;
+        p = q;
+
+        if (p >= c->tail) {
+            return json_cursor_fail(c, JSON_PARSER_ERROR_STRING_MISS_QUOTATION_MARK);
+        }
+
+        if ('"' == *p) {
+            break;
+        }
+
+        if (c->tail - p < 2) {
+            return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+        }
+
+        switch (p[1]) {
+        case '\\':
+        case '/':
+        case '"':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            break;
+        case 'u': {
+            int32_t cp = (c->tail - p >= 6) ? json_hex4(p + 2) : -1;
+            int32_t low;
+
+            if (cp < 0) {
+                return json_cursor_fail(c, JSON_PARSER_ERROR_STRING_UNICODE_ESCAPE_INVALID_HEX);
+            }
+
+            p += 6;
+
+            if (JSON_UTF8_IS_LOW(cp)) {
+                return json_cursor_fail(c, JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID);
+            }
+
+            if (!JSON_UTF8_IS_HIGH(cp)) {
+                len += json_utf8_size((uint32_t)cp);
+                continue;
+            }
+
+            if ((c->tail - p < 2) || ('\\' != p[0]) || ('u' != p[1])) {
+                return json_cursor_fail(c, JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID);
+            }
+
+            if ((low = (c->tail - p >= 6) ? json_hex4(p + 2) : -1) < 0) {
+                return json_cursor_fail(c, JSON_PARSER_ERROR_STRING_UNICODE_ESCAPE_INVALID_HEX);
+            }
+
+            if (!JSON_UTF8_IS_LOW(low)) {
+                return json_cursor_fail(c, JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID);
+            }
+
+            p += 6;
+            len += 4;
+            continue;
+        }
+        default:
+            return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+        }
+
+        p += 2;
+        ++len;
+    }
+
+    str->len = len;
+    c->src = p + 1;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+json_cursor_on_int(void *ctx, int i)
+{
+    struct json_cursor_scalar_t *s = ctx;
+
+    s->type = JSON_VALUE_TYPE_INT64;
+    s->i64 = i;
+
+    return 0;
+}
+
+
+static int
+json_cursor_on_uint(void *ctx, unsigned int i)
+{
+    struct json_cursor_scalar_t *s = ctx;
+
+    s->type = JSON_VALUE_TYPE_INT64;
+    s->i64 = i;
+
+    return 0;
+}
+
+
+static int
+json_cursor_on_int64(void *ctx, int64_t i)
+{
+    struct json_cursor_scalar_t *s = ctx;
+
+    s->type = JSON_VALUE_TYPE_INT64;
+    s->i64 = i;
+
+    return 0;
+}
+
+
+static int
+json_cursor_on_uint64(void *ctx, uint64_t i)
+{
+    struct json_cursor_scalar_t *s = ctx;
+
+    s->type = JSON_VALUE_TYPE_UINT64;
+    s->u64 = i;
+
+    return 0;
+}
+
+
+static int
+json_cursor_on_double(void *ctx, double d)
+{
+    struct json_cursor_scalar_t *s = ctx;
+
+    s->type = JSON_VALUE_TYPE_DOUBLE;
+    s->d = d;
+
+    return 0;
+}
+
+
+/* numbers only: literals are matched directly */
+static struct json_parser_handler_vtbl_t
+json_cursor_scalar_vtbl = {
+    NULL,
+    NULL,
+    &json_cursor_on_int,
+    &json_cursor_on_uint,
+    &json_cursor_on_int64,
+    &json_cursor_on_uint64,
+    &json_cursor_on_double,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+static int
+json_cursor_number(struct json_cursor_t *c, struct json_parser_handler_t *h)
+{
+    struct json_number_t n = { 0, 0, 0, 0 };
+    const char *head = c->src;
+    const char *p = head;
+    const char *end = c->tail;
+    int is_int = 1;
+
+    if ((p < end) && ('-' == *p)) {
+        n.negative = 1;
+        ++p;
+    }
+
+    if ((p < end) && ('0' == *p)) {
+        ++p;
+    }
+    else if ((p < end) && (*p >= '1') && (*p <= '9')) {
+        p = json_number_scan_digits(&n, p, end, 0);
+    }
+    else {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    if ((p < end) && ('.' == *p)) {
+        is_int = 0;
+
+        if ((++p == end) || (*p < '0') || (*p > '9')) {
+            return JSON_PARSER_ERROR_NUMBER_MISS_FRACTION;
+        }
+
+        p = json_number_scan_digits(&n, p, end, 1);
+    }
+
+    if ((p < end) && (('e' == *p) || ('E' == *p))) {
+        int e_negative = 0;
+        int64_t e = 0;
+
+        is_int = 0;
+        ++p;
+
+        if ((p < end) && (('-' == *p) || ('+' == *p))) {
+            e_negative = ('-' == *p++);
+        }
+
+        if ((p == end) || (*p < '0') || (*p > '9')) {
+            return JSON_PARSER_ERROR_NUMBER_MISS_EXPONENT;
+        }
+
+        for (; (p < end) && (*p >= '0') && (*p <= '9'); ++p) {
+            if (e < 0x10000000) {
+                e = e * 10 + (*p - '0');
+            }
+        }
+
+        n.exponent += e_negative ? -e : e;
+    }
+
+    c->src = p;
+
+    return json_number_emit(h, &n, is_int, head, p - head);
+}
+
+
+/* reads the scalar at src into s and moves past it */
+static int
+json_cursor_scalar(struct json_cursor_t *c, struct json_cursor_scalar_t *s)
+{
+    struct json_parser_handler_t h = { &json_cursor_scalar_vtbl, s };
+    const char *end;
+    int r;
+
+    if (c->error) {
+        return c->error;
+    }
+
+    if (!c->pending || (c->src >= c->tail)) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    c->pending = 0;
+
+    switch (*c->src) {
+    case 't':
+    case 'f':
+    case 'n':
+        end = json_cursor_skip_scalar(c, c->src);
+
+        if ((4 == end - c->src) && !memcmp(c->src, "null", 4)) {
+            s->type = JSON_VALUE_TYPE_NULL;
+        }
+        else if ((4 == end - c->src) && !memcmp(c->src, "true", 4)) {
+            s->type = JSON_VALUE_TYPE_BOOL;
+            s->b = 1;
+        }
+        else if ((5 == end - c->src) && !memcmp(c->src, "false", 5)) {
+            s->type = JSON_VALUE_TYPE_BOOL;
+            s->b = 0;
+        }
+        else {
+            return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+        }
+
+        c->src = end;
+
+        return JSON_PARSER_ERROR_OK;
+
+    default:
+        if ((r = json_cursor_number(c, &h))) {
+            return json_cursor_fail(c, r);
+        }
+
+        return JSON_PARSER_ERROR_OK;
+    }
+}
+
+
+void
+json_cursor_init(struct json_cursor_t *c, const char *str, size_t len)
+{
+    c->src = str;
+    c->tail = str + len;
+    c->simd = json_simd();
+
+    c->error = JSON_PARSER_ERROR_OK;
+    c->pending = 1;
+    c->first = 0;
+
+    c->depth = 0;
+    memset(c->objects, 0, sizeof c->objects);
+
+    json_cursor_skip_ws(c);
+}
+
+
+enum json_value_type_t
+json_cursor_type(const struct json_cursor_t *c)
+{
+    if (c->error || !c->pending || (c->src >= c->tail)) {
+        return JSON_VALUE_TYPE_NONE;
+    }
+
+    switch (*c->src) {
+    case '{':
+        return JSON_VALUE_TYPE_OBJECT;
+    case '[':
+        return JSON_VALUE_TYPE_ARRAY;
+    case '"':
+        return JSON_VALUE_TYPE_STRING;
+    case 't':
+    case 'f':
+        return JSON_VALUE_TYPE_BOOL;
+    case 'n':
+        return JSON_VALUE_TYPE_NULL;
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        for (const char *p = c->src + 1; p < c->tail; ++p) {
+            if (('.' == *p) || ('e' == *p) || ('E' == *p)) {
+                return JSON_VALUE_TYPE_DOUBLE;
+            }
+
+            if ((*p < '0') || (*p > '9')) {
+                break;
+            }
+        }
+
+        return JSON_VALUE_TYPE_INT64;
+    default:
+        return JSON_VALUE_TYPE_NONE;
+    }
+}
+
+
+int
+json_cursor_enter(struct json_cursor_t *c)
+{
+    if (c->error) {
+        return c->error;
+    }
+
+    if (!c->pending || (c->src >= c->tail) || (('{' != *c->src) && ('[' != *c->src))) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    if (c->depth == JSON_CURSOR_MAX_DEPTH) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_TERMINATION);
+    }
+
+    uint64_t bit = (uint64_t)1 << (c->depth % 64);
+
+    if ('{' == *c->src) {
+        c->objects[c->depth / 64] |= bit;
+    }
+    else {
+        c->objects[c->depth / 64] &= ~bit;
+    }
+
+    ++c->depth;
+    ++c->src;
+
+    c->pending = 0;
+    c->first = 1;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_cursor_skip(struct json_cursor_t *c)
+{
+    const char *end;
+
+    if (c->error) {
+        return c->error;
+    }
+
+    if (!c->pending) {
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    if (c->src >= c->tail) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    switch (*c->src) {
+    case '{':
+    case '[':
+        end = json_simd_skip_container(c->simd, c->src, c->tail, 0);
+        break;
+    case '"':
+        end = json_cursor_skip_string(c, c->src + 1);
+        break;
+    default:
+        end = json_cursor_skip_scalar(c, c->src);
+        break;
+    }
+
+    if (!end || (end == c->src)) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    c->src = end;
+    c->pending = 0;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_cursor_next(struct json_cursor_t *c, struct json_string_t *key)
+{
+    if (c->error || !c->depth || json_cursor_skip(c)) {
+        return 0;
+    }
+
+    int is_object = JSON_CURSOR_IS_OBJECT(c, c->depth - 1);
+
+    json_cursor_skip_ws(c);
+
+    if (c->src >= c->tail) {
+        json_cursor_fail(c, is_object
+                            ? JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET
+                            : JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET);
+        return 0;
+    }
+
+    if (*c->src == (is_object ? '}' : ']')) {
+        ++c->src;
+        --c->depth;
+        c->first = 0;
+        return 0;
+    }
+
+    if (!c->first) {
+        if (',' != *c->src) {
+            json_cursor_fail(c, is_object
+                                ? JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET
+                                : JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET);
+            return 0;
+        }
+
+        ++c->src;
+        json_cursor_skip_ws(c);
+    }
+
+    c->first = 0;
+
+    if (is_object) {
+        struct json_string_t k;
+
+        if ((c->src >= c->tail) || ('"' != *c->src)) {
+            json_cursor_fail(c, JSON_PARSER_ERROR_OBJECT_MISS_NAME);
+            return 0;
+        }
+
+        if (json_cursor_string(c, key ? key : &k)) {
+            return 0;
+        }
+
+        json_cursor_skip_ws(c);
+
+        if ((c->src >= c->tail) || (':' != *c->src)) {
+            json_cursor_fail(c, JSON_PARSER_ERROR_OBJECT_MISS_COLON);
+            return 0;
+        }
+
+        ++c->src;
+        json_cursor_skip_ws(c);
+    }
+
+    c->pending = 1;
+
+    return 1;
+}
+
+
+int
+json_cursor_find(struct json_cursor_t *c, const char *key, size_t len)
+{
+    struct json_string_t k;
+
+    while (json_cursor_next(c, &k)) {
+        if (json_string_equal(&k, key, len)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void
+json_cursor_leave(struct json_cursor_t *c)
+{
+    if (c->error || !c->depth) {
+        return;
+    }
+
+    if (json_cursor_skip(c)) {
+        return;
+    }
+
+    const char *end = json_simd_skip_container(c->simd, c->src, c->tail, 1);
+
+    if (!end) {
+        json_cursor_fail(c, JSON_CURSOR_IS_OBJECT(c, c->depth - 1)
+                            ? JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET
+                            : JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET);
+        return;
+    }
+
+    c->src = end;
+    c->first = 0;
+    --c->depth;
+}
+
+
+int
+json_cursor_get_string(struct json_cursor_t *c, struct json_string_t *str)
+{
+    if (c->error) {
+        return c->error;
+    }
+
+    if (!c->pending || (c->src >= c->tail) || ('"' != *c->src)) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    c->pending = 0;
+
+    return json_cursor_string(c, str);
+}
+
+
+int
+json_cursor_get_int64(struct json_cursor_t *c, int64_t *i)
+{
+    struct json_cursor_scalar_t s;
+    int r = json_cursor_scalar(c, &s);
+
+    if (r) {
+        return r;
+    }
+
+    if (JSON_VALUE_TYPE_INT64 != s.type) {
+        return json_cursor_fail(c, (JSON_VALUE_TYPE_UINT64 == s.type)
+                                   ? JSON_PARSER_ERROR_NUMBER_TOO_BIG : JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    *i = s.i64;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_cursor_get_uint64(struct json_cursor_t *c, uint64_t *u)
+{
+    struct json_cursor_scalar_t s;
+    int r = json_cursor_scalar(c, &s);
+
+    if (r) {
+        return r;
+    }
+
+    if ((JSON_VALUE_TYPE_UINT64 == s.type) || ((JSON_VALUE_TYPE_INT64 == s.type) && (s.i64 >= 0))) {
+        *u = (JSON_VALUE_TYPE_UINT64 == s.type) ? s.u64 : (uint64_t)s.i64;
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+}
+
+
+int
+json_cursor_get_double(struct json_cursor_t *c, double *d)
+{
+    struct json_cursor_scalar_t s;
+    int r = json_cursor_scalar(c, &s);
+
+    if (r) {
+        return r;
+    }
+
+    switch (s.type) {
+    case JSON_VALUE_TYPE_DOUBLE:
+        *d = s.d;
+        return JSON_PARSER_ERROR_OK;
+    case JSON_VALUE_TYPE_INT64:
+        *d = (double)s.i64;
+        return JSON_PARSER_ERROR_OK;
+    case JSON_VALUE_TYPE_UINT64:
+        *d = (double)s.u64;
+        return JSON_PARSER_ERROR_OK;
+    default:
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+}
+
+
+int
+json_cursor_get_bool(struct json_cursor_t *c, int *b)
+{
+    struct json_cursor_scalar_t s;
+    int r = json_cursor_scalar(c, &s);
+
+    if (r) {
+        return r;
+    }
+
+    if (JSON_VALUE_TYPE_BOOL != s.type) {
+        return json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+    }
+
+    *b = s.b;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+int
+json_cursor_get_null(struct json_cursor_t *c)
+{
+    struct json_cursor_scalar_t s;
+    int r = json_cursor_scalar(c, &s);
+
+    if (r) {
+        return r;
+    }
+
+    return (JSON_VALUE_TYPE_NULL == s.type) ? JSON_PARSER_ERROR_OK : json_cursor_fail(c, JSON_PARSER_ERROR_VALUE_INVALID);
+}
@@ -0,0 +1,66 @@
+#ifndef _JSON_CURSOR_H_INCLUDED
+#define _JSON_CURSOR_H_INCLUDED
+
+#include <stdint.h>
+#include "json_parser.h"
+#include "json_simd.h"
+
+
+#define JSON_CURSOR_MAX_DEPTH       256
+
+
+/*
+ * forward-only reader over a document in memory that builds nothing.
+ * the cursor sits on a value; reading it (get_*), entering it or
+ * skipping it moves past. json_cursor_next moves to the next element
+ * of the innermost entered container, skipping whatever the previous
+ * element left unread; json_cursor_leave drops the rest of it. skipped
+ * subtrees are only scanned for brackets and quotes, not validated, and
+ * cost no allocation or callback.
+ *
+ * next and find return 1 when positioned on an element and 0 at the end
+ * of the container or on error, told apart by c->error. the getters
+ * return a JSON_PARSER_ERROR_* code.
+ */
+struct json_cursor_t {
+    const char *src;
+    const char *tail;
+    const struct json_simd_vtbl_t *simd;
+
+    int error;
+    int pending;
+    int first;
+
+    size_t depth;
+    uint64_t objects[JSON_CURSOR_MAX_DEPTH / 64];
+};
+
+
+void json_cursor_init(struct json_cursor_t *c, const char *str, size_t len);
+
+enum json_value_type_t json_cursor_type(const struct json_cursor_t *c);
+
+int json_cursor_enter(struct json_cursor_t *c);
+
+int json_cursor_next(struct json_cursor_t *c, struct json_string_t *key);
+
+int json_cursor_find(struct json_cursor_t *c, const char *key, size_t len);
+
+void json_cursor_leave(struct json_cursor_t *c);
+
+int json_cursor_skip(struct json_cursor_t *c);
+
+int json_cursor_get_string(struct json_cursor_t *c, struct json_string_t *str);
+
+int json_cursor_get_int64(struct json_cursor_t *c, int64_t *i);
+
+int json_cursor_get_uint64(struct json_cursor_t *c, uint64_t *u);
+
+int json_cursor_get_double(struct json_cursor_t *c, double *d);
+
+int json_cursor_get_bool(struct json_cursor_t *c, int *b);
+
+int json_cursor_get_null(struct json_cursor_t *c);
+
+
+#endif //_JSON_CURSOR_H_INCLUDED
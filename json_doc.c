@@ -0,0 +1,45 @@
+#include "json_doc.h"
+
+
+struct json_doc_t *
+json_doc_freeze(struct json_parser_t *parser)
+{
+    if (!parser->root || (parser->a != &parser->arena_allocator)) {
+        return NULL;
+    }
+
+    /* copied strings are in the arena already, unless a key table has them */
+    if ((!(parser->flags & JSON_PARSER_COPY_STRINGS) || parser->keys)
+        && json_value_copy_strings(&parser->arena, parser->root)) {
+        return NULL;
+    }
+
+    struct json_doc_t *doc = json_arena_alloc(&parser->arena, sizeof(struct json_doc_t));
+    if (!doc) {
+        return NULL;
+    }
+
+    doc->root = parser->root;
+    doc->refs = 1;
+
+    json_arena_init(&doc->arena, 0);
+    json_arena_merge(&doc->arena, &parser->arena);
+
+    parser->root = NULL;
+
+    return doc;
+}
+
+
+void
+json_doc_release(struct json_doc_t *doc)
+{
+    if (__atomic_sub_fetch(&doc->refs, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+
+    /* the document is in the arena it frees */
+    struct json_arena_t arena = doc->arena;
+
+    json_arena_release(&arena);
+}
@@ -0,0 +1,52 @@
+#ifndef _JSON_DOC_H_INCLUDED
+#define _JSON_DOC_H_INCLUDED
+
+#include "json_parser.h"
+
+
+/*
+ * a parsed tree taken off its parser for good. the document owns the
+ * arena the tree and all its strings live in, itself included, and
+ * nothing writes to any of it again: threads read it at once through
+ * the usual accessors (json_object_get, json_array_get, json_strcpy,
+ * json_write, ...) with no lock, each holding a reference. the last
+ * json_doc_release frees it, however long the parser is gone by then.
+ */
+struct json_doc_t {
+    const struct json_value_t *root;
+    size_t refs;
+    struct json_arena_t arena;
+};
+
+
+/*
+ * the parser's last tree as a document holding one reference; the
+ * parser is left without a root, ready for the next parse. strings
+ * that point into the input or a key table are copied first. NULL if
+ * out of memory, there is no tree, or it lives with a caller-supplied
+ * allocator rather than the parser's own arena. the document keeps
+ * the arena's chunks whole, so many small ones kept at once are better
+ * parsed with a smaller parser->arena.chunk_size.
+ */
+struct json_doc_t *json_doc_freeze(struct json_parser_t *parser);
+
+void json_doc_release(struct json_doc_t *doc);
+
+
+static inline struct json_doc_t *
+json_doc_retain(struct json_doc_t *doc)
+{
+    __atomic_fetch_add(&doc->refs, 1, __ATOMIC_RELAXED);
+
+    return doc;
+}
+
+
+static inline const struct json_value_t *
+json_doc_root(const struct json_doc_t *doc)
+{
+    return doc->root;
+}
+
+
+#endif //_JSON_DOC_H_INCLUDED
@@ -0,0 +1,93 @@
+#include "json_index.h"
+#include "json_simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define JSON_INDEX_CHUNK        (64 * JSON_SIMD_BLOCK_SIZE)
+
+
+static int
+json_index_reserve(struct json_index_t *index, size_t n)
+{
+    if (index->count + n <= index->capacity) {
+        return 0;
+    }
+
+    size_t capacity = index->capacity ? index->capacity : 1024;
+    while (index->count + n > capacity) {
+        capacity *= 2;
+    }
+
+    uint32_t *pos = realloc(index->pos, capacity * sizeof(uint32_t));
+    if (!pos) {
+        return -1;
+    }
+
+    index->pos = pos;
+    index->capacity = capacity;
+    ++index->mallocs;
+
+    return 0;
+}
+
+
+int
+json_index_build(struct json_index_t *index, const char *str, size_t len)
+{
+    const struct json_simd_vtbl_t *simd = json_simd();
+    struct json_simd_index_state_t s = { 0, 0, 0 };
+    size_t i = 0;
+
+    if (len > UINT32_MAX - JSON_SIMD_BLOCK_SIZE) {
+        return -1;
+    }
+
+    index->count = 0;
+
+    if (json_index_reserve(index, len / 8 + JSON_INDEX_CHUNK + 1)) {
+        return -1;
+    }
+
+    while (len - i >= JSON_SIMD_BLOCK_SIZE) {
+        size_t n = len - i;
+
+        if (n > JSON_INDEX_CHUNK) {
+            n = JSON_INDEX_CHUNK;
+        }
+
+        n -= n % JSON_SIMD_BLOCK_SIZE;
+
+        if (json_index_reserve(index, n + 1)) {
+            return -1;
+        }
+
+        index->count += simd->index(str + i, n, (uint32_t)i, index->pos + index->count, &s);
+        i += n;
+    }
+
+    if (json_index_reserve(index, JSON_SIMD_BLOCK_SIZE + 1)) {
+        return -1;
+    }
+
+    if (i < len) {
+        char tail[JSON_SIMD_BLOCK_SIZE];
+
+        memset(tail, ' ', sizeof tail);
+        memcpy(tail, str + i, len - i);
+
+        index->count += simd->index(tail, sizeof tail, (uint32_t)i, index->pos + index->count, &s);
+    }
+
+    index->pos[index->count] = (uint32_t)len;
+
+    return 0;
+}
+
+
+void
+json_index_free(struct json_index_t *index)
+{
+    free(index->pos);
+    json_index_init(index);
+}
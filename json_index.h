@@ -0,0 +1,33 @@
+#ifndef _JSON_INDEX_H_INCLUDED
+#define _JSON_INDEX_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* built again over the next input, an index keeps its capacity */
+struct json_index_t {
+    uint32_t *pos;
+    size_t count;
+    size_t capacity;
+
+    /* times pos was (re)allocated */
+    size_t mallocs;
+};
+
+
+static inline void
+json_index_init(struct json_index_t *index)
+{
+    index->pos = NULL;
+    index->count = index->capacity = 0;
+    index->mallocs = 0;
+}
+
+
+int json_index_build(struct json_index_t *index, const char *str, size_t len);
+
+void json_index_free(struct json_index_t *index);
+
+
+#endif //_JSON_INDEX_H_INCLUDED
@@ -0,0 +1,212 @@
+#include "json_keys.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+void
+json_keys_init(struct json_keys_t *keys, size_t max)
+{
+    keys->entries = NULL;
+    keys->count = keys->capacity = 0;
+    keys->max = max ? max : JSON_KEYS_MAX;
+
+    keys->slots = NULL;
+    keys->mask = 0;
+
+    json_arena_init(&keys->arena, 0);
+}
+
+
+void
+json_keys_free(struct json_keys_t *keys)
+{
+    free(keys->entries);
+    free(keys->slots);
+    json_arena_release(&keys->arena);
+
+    keys->entries = NULL;
+    keys->count = keys->capacity = 0;
+    keys->slots = NULL;
+    keys->mask = 0;
+}
+
+
+static int
+json_keys_grow(struct json_keys_t *keys)
+{
+    size_t capacity = keys->capacity ? keys->capacity * 2 : 64;
+
+    /* twice as many slots as entries can get */
+    size_t mask = capacity * 2 - 1;
+
+    uint32_t *slots = calloc(mask + 1, sizeof(uint32_t));
+    if (!slots) {
+        return -1;
+    }
+
+    struct json_keys_entry_t *entries = realloc(keys->entries, capacity * sizeof(struct json_keys_entry_t));
+    if (!entries) {
+        free(slots);
+        return -1;
+    }
+
+    for (size_t i = 0; i < keys->count; ++i) {
+        size_t slot = entries[i].hash & mask;
+
+        while (slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+
+        slots[slot] = (uint32_t)(i + 1);
+    }
+
+    free(keys->slots);
+
+    keys->entries = entries;
+    keys->capacity = capacity;
+    keys->slots = slots;
+    keys->mask = mask;
+
+    return 0;
+}
+
+
+static inline uint64_t
+json_keys_hash(const char *s, size_t len)
+{
+    uint64_t h = len * UINT64_C(0x9E3779B97F4A7C15);
+    uint64_t w;
+
+    for (; len >= 8; s += 8, len -= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ w) * UINT64_C(0xFF51AFD7ED558CCD);
+        h ^= h >> 32;
+    }
+
+    for (w = 0; len; --len) {
+        w = (w << 8) | (unsigned char)s[len - 1];
+    }
+
+    h = (h ^ w) * UINT64_C(0xC4CEB9FE1A85EC53);
+
+    return h ^ (h >> 29);
+}
+
+
+/* the key str (len once unescaped) as plain bytes: str itself unless it has escapes */
+static inline const char *
+json_keys_plain(const char *str, size_t len, char *buf)
+{
+    if (!memchr(str, '\\', len)) {
+        return str;
+    }
+
+    if (len > JSON_KEYS_DECODE_MAX) {
+        return NULL;
+    }
+
+    struct json_string_t key = { (char *)str, len };
+    json_strcpy(buf, &key, len);
+
+    return buf;
+}
+
+
+static uint32_t
+json_keys_lookup(const struct json_keys_t *keys, const char *key, size_t len, uint64_t hash)
+{
+    uint32_t id;
+
+    if (!keys->slots) {
+        return 0;
+    }
+
+    for (size_t slot = hash & keys->mask; (id = keys->slots[slot]); slot = (slot + 1) & keys->mask) {
+        const struct json_keys_entry_t *e = &keys->entries[id - 1];
+
+        if ((e->hash == hash) && (e->str.len == len)
+            && (e->escaped ? json_string_equal(&e->str, key, len) : !memcmp(e->str.data, key, len))) {
+            return id;
+        }
+    }
+
+    return 0;
+}
+
+
+const struct json_string_t *
+json_keys_intern(struct json_keys_t *keys, const char *str, size_t len)
+{
+    char buf[JSON_KEYS_DECODE_MAX];
+    const char *key = json_keys_plain(str, len, buf);
+
+    if (!key) {
+        return NULL;
+    }
+
+    uint64_t hash = json_keys_hash(key, len);
+    uint32_t id = json_keys_lookup(keys, key, len, hash);
+
+    if (id) {
+        return &keys->entries[id - 1].str;
+    }
+
+    if (keys->count == keys->max) {
+        return NULL;
+    }
+
+    if ((keys->count == keys->capacity) && json_keys_grow(keys)) {
+        return NULL;
+    }
+
+    const char *src = key;
+    size_t size = len;
+    int escaped = 0;
+
+    if (!json_string_is_plain(key, len)) {
+        struct json_string_t raw = { (char *)str, len };
+
+        src = str;
+        size = json_string_raw_size(&raw);
+        escaped = 1;
+    }
+
+    char *p = json_arena_alloc(&keys->arena, size ? size : 1);
+    if (!p) {
+        return NULL;
+    }
+
+    memcpy(p, src, size);
+
+    struct json_keys_entry_t *e = &keys->entries[keys->count++];
+
+    e->str.data = p;
+    e->str.len = len;
+    e->hash = hash;
+    e->escaped = escaped;
+
+    size_t slot;
+    for (slot = hash & keys->mask; keys->slots[slot]; slot = (slot + 1) & keys->mask) {
+    }
+
+    keys->slots[slot] = (uint32_t)keys->count;
+
+    return &e->str;
+}
+
+
+uint32_t
+json_keys_id(const struct json_keys_t *keys, const struct json_string_t *key)
+{
+    char buf[JSON_KEYS_DECODE_MAX];
+    const char *plain = json_keys_plain(key->data, key->len, buf);
+
+    return plain ? json_keys_lookup(keys, plain, key->len, json_keys_hash(plain, key->len)) : 0;
+}
+
+
+uint32_t
+json_keys_find(const struct json_keys_t *keys, const char *key, size_t len)
+{
+    return json_keys_lookup(keys, key, len, json_keys_hash(key, len));
+}
@@ -0,0 +1,70 @@
+#ifndef _JSON_KEYS_H_INCLUDED
+#define _JSON_KEYS_H_INCLUDED
+
+#include "json.h"
+
+
+#define JSON_KEYS_MAX               (64 * 1024)
+
+/* longer keys with escapes in them are not interned */
+#define JSON_KEYS_DECODE_MAX        256
+
+
+struct json_keys_entry_t {
+    struct json_string_t str;
+    uint64_t hash;
+    int escaped;
+};
+
+
+/*
+ * object keys interned across documents. a parser pointed at the table
+ * (parser->keys) gives every key it takes the table's copy, so equal keys
+ * share one pointer and an id (1, 2, ... in order of first sight) that
+ * stay valid until json_keys_free, through any number of parses. keys
+ * past max distinct ones are kept the usual way. a table serves one
+ * parser at a time.
+ *
+ * the interned copy is unescaped unless that would need escapes again:
+ * "a\/b" and "a/b" both come out as "a/b".
+ */
+struct json_keys_t {
+    struct json_keys_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    size_t max;
+
+    uint32_t *slots;
+    size_t mask;
+
+    struct json_arena_t arena;
+};
+
+
+/* max 0: JSON_KEYS_MAX */
+void json_keys_init(struct json_keys_t *keys, size_t max);
+
+void json_keys_free(struct json_keys_t *keys);
+
+/*
+ * the interned copy of the key str (source form, len once unescaped),
+ * added if new; NULL when the table is full. the pointer itself is good
+ * until the next intern, the string it holds until json_keys_free.
+ */
+const struct json_string_t *json_keys_intern(struct json_keys_t *keys, const char *str, size_t len);
+
+/* id of a key as it appears in a DOM, 0 if the table does not have it */
+uint32_t json_keys_id(const struct json_keys_t *keys, const struct json_string_t *key);
+
+/* id of the plain (unescaped) key, 0 if the table does not have it */
+uint32_t json_keys_find(const struct json_keys_t *keys, const char *key, size_t len);
+
+
+static inline const struct json_string_t *
+json_keys_get(const struct json_keys_t *keys, uint32_t id)
+{
+    return (id && (id <= keys->count)) ? &keys->entries[id - 1].str : NULL;
+}
+
+
+#endif //_JSON_KEYS_H_INCLUDED
@@ -0,0 +1,273 @@
+#include "json_ndjson.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+
+struct json_ndjson_t {
+    const char *str;
+    size_t len;
+    unsigned flags;
+    uint16_t max_depth;
+    struct json_ndjson_handler_t *handler;
+
+    size_t batches;
+    size_t next_batch;
+    int stop;
+
+    /* the batch whose records go out next, in ordered mode */
+    size_t turn;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+
+struct json_ndjson_worker_t {
+    struct json_ndjson_t *job;
+    pthread_t thread;
+
+    /* values of a whole batch stay here until its records are delivered */
+    struct json_arena_t arena;
+    struct json_allocator_t a;
+    struct json_parser_t parser;
+
+    struct json_ndjson_record_t *records;
+    size_t records_size;
+    size_t records_capacity;
+};
+
+
+static void *
+json_ndjson_on_alloc(void *ctx, size_t size)
+{
+    return json_arena_alloc(ctx, size);
+}
+
+
+static void
+json_ndjson_on_free(void *ctx, void *p)
+{
+}
+
+
+static void
+json_ndjson_on_reset(void *ctx)
+{
+}
+
+
+/* the parser's reset leaves earlier records of the batch alone; the worker releases them */
+static struct json_allocator_vtbl_t
+json_ndjson_allocator_vtbl = {
+    &json_ndjson_on_alloc,
+    &json_ndjson_on_free,
+    &json_ndjson_on_reset
+};
+
+
+/* first line starting at or after pos */
+static size_t
+json_ndjson_line_start(const struct json_ndjson_t *job, size_t pos)
+{
+    if (!pos) {
+        return 0;
+    }
+
+    if (pos >= job->len) {
+        return job->len;
+    }
+
+    const char *nl = memchr(job->str + pos - 1, '\n', job->len - pos + 1);
+
+    return nl ? (size_t)(nl - job->str) + 1 : job->len;
+}
+
+
+static int
+json_ndjson_parse_batch(struct json_ndjson_worker_t *w, const char *p, const char *end)
+{
+    w->records_size = 0;
+
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *line_end = nl ? nl : end;
+        const char *q = p;
+
+        while ((q < line_end) && JSON_PARSER_IS_WS(*q)) {
+            ++q;
+        }
+
+        if (q < line_end) {
+            if (w->records_size == w->records_capacity) {
+                size_t capacity = w->records_capacity ? w->records_capacity * 2 : 256;
+
+                struct json_ndjson_record_t *records = realloc(w->records, capacity * sizeof(struct json_ndjson_record_t));
+                if (!records) {
+                    return -1;
+                }
+
+                w->records = records;
+                w->records_capacity = capacity;
+            }
+
+            struct json_ndjson_record_t *record = &w->records[w->records_size++];
+
+            record->str = p;
+            record->len = line_end - p;
+            record->error = json_parse_str(&w->parser, q, line_end - q);
+            record->root = record->error ? NULL : w->parser.root;
+        }
+
+        p = line_end + 1;
+    }
+
+    return 0;
+}
+
+
+static int
+json_ndjson_deliver(struct json_ndjson_worker_t *w)
+{
+    struct json_ndjson_handler_t *handler = w->job->handler;
+
+    for (size_t i = 0; i < w->records_size; ++i) {
+        if (__atomic_load_n(&w->job->stop, __ATOMIC_RELAXED)) {
+            return -1;
+        }
+
+        if (handler->on_record(handler->ctx, &w->records[i])) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void *
+json_ndjson_work(void *arg)
+{
+    struct json_ndjson_worker_t *w = arg;
+    struct json_ndjson_t *job = w->job;
+    int ordered = job->flags & JSON_NDJSON_ORDERED;
+
+    while (!__atomic_load_n(&job->stop, __ATOMIC_RELAXED)) {
+        size_t b = __atomic_fetch_add(&job->next_batch, 1, __ATOMIC_RELAXED);
+        if (b >= job->batches) {
+            break;
+        }
+
+        size_t begin = json_ndjson_line_start(job, b * JSON_NDJSON_BATCH_SIZE);
+        size_t end = json_ndjson_line_start(job, (b + 1) * JSON_NDJSON_BATCH_SIZE);
+
+        int r = json_ndjson_parse_batch(w, job->str + begin, job->str + end);
+
+        if (ordered) {
+            pthread_mutex_lock(&job->lock);
+            while ((job->turn != b) && !__atomic_load_n(&job->stop, __ATOMIC_RELAXED)) {
+                pthread_cond_wait(&job->cond, &job->lock);
+            }
+            pthread_mutex_unlock(&job->lock);
+        }
+
+        if (r || json_ndjson_deliver(w)) {
+            __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+        }
+
+        if (ordered) {
+            pthread_mutex_lock(&job->lock);
+            ++job->turn;
+            pthread_cond_broadcast(&job->cond);
+            pthread_mutex_unlock(&job->lock);
+        }
+
+        json_arena_release(&w->arena);
+    }
+
+    if (ordered) {
+        /* wake anyone waiting on a turn that will never come */
+        pthread_mutex_lock(&job->lock);
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    return NULL;
+}
+
+
+int
+json_parse_ndjson(const char *str, size_t len, unsigned threads, unsigned flags, uint16_t max_depth,
+                  struct json_ndjson_handler_t *handler)
+{
+    struct json_ndjson_t job;
+    unsigned i;
+
+    job.str = str;
+    job.len = len;
+    job.flags = flags;
+    job.max_depth = max_depth;
+    job.handler = handler;
+    job.batches = (len + JSON_NDJSON_BATCH_SIZE - 1) / JSON_NDJSON_BATCH_SIZE;
+    job.next_batch = 0;
+    job.stop = 0;
+    job.turn = 0;
+
+    if (!threads) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (n > 0) ? (unsigned)n : 1;
+    }
+
+    if (threads > job.batches) {
+        threads = job.batches ? (unsigned)job.batches : 1;
+    }
+
+    struct json_ndjson_worker_t *workers = calloc(threads, sizeof(struct json_ndjson_worker_t));
+    if (!workers) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    unsigned started = 0;
+
+    for (i = 0; i < threads; ++i) {
+        struct json_ndjson_worker_t *w = &workers[i];
+
+        w->job = &job;
+
+        json_arena_init(&w->arena, 0);
+        w->a.vtbl = &json_ndjson_allocator_vtbl;
+        w->a.ctx = &w->arena;
+        json_parser_init(&w->parser, max_depth, &w->a);
+    }
+
+    /* the calling thread is worker 0 */
+    for (i = 1; i < threads; ++i) {
+        if (pthread_create(&workers[i].thread, NULL, &json_ndjson_work, &workers[i])) {
+            break;
+        }
+
+        ++started;
+    }
+
+    json_ndjson_work(&workers[0]);
+
+    for (i = 1; i <= started; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    for (i = 0; i < threads; ++i) {
+        json_parser_clear(&workers[i].parser);
+        json_arena_release(&workers[i].arena);
+        free(workers[i].records);
+    }
+
+    free(workers);
+
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+
+    return job.stop ? JSON_PARSER_ERROR_TERMINATION : JSON_PARSER_ERROR_OK;
+}
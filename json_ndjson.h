@@ -0,0 +1,47 @@
+#ifndef _JSON_NDJSON_H_INCLUDED
+#define _JSON_NDJSON_H_INCLUDED
+
+#include "json_parser.h"
+
+
+#define JSON_NDJSON_BATCH_SIZE      (256 * 1024)
+
+/* records reach the handler in input order rather than as workers finish them */
+#define JSON_NDJSON_ORDERED         0x1
+
+
+/*
+ * one line of input. root is NULL when error is set; it and the strings
+ * it points to (into the input) are valid only during on_record.
+ */
+struct json_ndjson_record_t {
+    const char *str;
+    size_t len;
+    int error;
+    struct json_value_t *root;
+};
+
+
+/*
+ * on_record runs on the worker threads: one at a time and in input order
+ * with JSON_NDJSON_ORDERED, concurrently otherwise. a non-zero return
+ * stops the whole parse.
+ */
+struct json_ndjson_handler_t {
+    int(*on_record)(void *ctx, const struct json_ndjson_record_t *record);
+    void *ctx;
+};
+
+
+/*
+ * parses newline delimited JSON on a pool of threads (0: one per online
+ * cpu). the input is cut into batches at line boundaries and each worker
+ * parses whole batches with its own parser and arena. blank lines are
+ * skipped; a malformed line is reported through its record, it does not
+ * stop the parse.
+ */
+int json_parse_ndjson(const char *str, size_t len, unsigned threads, unsigned flags, uint16_t max_depth,
+                      struct json_ndjson_handler_t *handler);
+
+
+#endif //_JSON_NDJSON_H_INCLUDED
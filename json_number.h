@@ -0,0 +1,145 @@
+#ifndef _JSON_NUMBER_H_INCLUDED
+#define _JSON_NUMBER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "json_parser.h"
+
+
+/* largest significand that can take one more decimal digit without overflow */
+#define JSON_NUMBER_MANTISSA_LIMIT  (UINT64_MAX / 10)
+
+
+struct json_number_t {
+    uint64_t mantissa;
+    int64_t exponent;
+    int negative;
+    int truncated;
+};
+
+
+static inline void
+json_number_push_digit(struct json_number_t *n, char c, int fraction)
+{
+    unsigned d = (unsigned)(c - '0');
+
+    if ((n->mantissa < JSON_NUMBER_MANTISSA_LIMIT)
+        || ((n->mantissa == JSON_NUMBER_MANTISSA_LIMIT) && (d <= UINT64_MAX % 10))) {
+
+        n->mantissa = n->mantissa * 10 + d;
+        n->exponent -= fraction;
+    }
+    else {
+        n->truncated |= (0 != d);
+        n->exponent += !fraction;
+    }
+}
+
+
+static inline int
+json_number_is_eight_digits(uint64_t v)
+{
+    return !(((v & UINT64_C(0xF0F0F0F0F0F0F0F0)) | (((v + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4))
+             ^ UINT64_C(0x3333333333333333));
+}
+
+
+static inline uint32_t
+json_number_parse_eight_digits(uint64_t v)
+{
+    const uint64_t mask = UINT64_C(0x000000FF000000FF);
+    const uint64_t mul1 = UINT64_C(0x000F424000000064);
+    const uint64_t mul2 = UINT64_C(0x0000271000000001);
+
+    v -= UINT64_C(0x3030303030303030);
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+
+    return (uint32_t)v;
+}
+
+
+/* consumes a run of digits from a contiguous buffer, eight at a time while they fit */
+static inline const char *
+json_number_scan_digits(struct json_number_t *n, const char *p, const char *end, int fraction)
+{
+    uint64_t v;
+
+    while ((end - p >= 8) && (n->mantissa < UINT64_C(100000000000))) {
+        memcpy(&v, p, sizeof v);
+
+        if (!json_number_is_eight_digits(v)) {
+            break;
+        }
+
+        n->mantissa = n->mantissa * 100000000 + json_number_parse_eight_digits(v);
+        n->exponent -= 8 * fraction;
+        p += 8;
+    }
+
+    while ((p < end) && ((unsigned)(*p - '0') < 10)) {
+        json_number_push_digit(n, *p++, fraction);
+    }
+
+    return p;
+}
+
+
+/*
+ * correctly rounded value of n; str/len is the number's source text, only
+ * read on the rare slow path where dropped digits make the result ambiguous.
+ */
+double json_number_to_double(const struct json_number_t *n, const char *str, size_t len);
+
+
+/* hands n to the narrowest handler that holds it exactly */
+static inline int
+json_number_emit(struct json_parser_handler_t *handler, const struct json_number_t *n, int is_int,
+                 const char *str, size_t len)
+{
+    int r;
+
+    if (is_int && !n->exponent) {
+        if (n->negative) {
+            if (n->mantissa <= (uint64_t)INT_MAX + 1) {
+                r = JSON_PARSER_HANDLER(handler, on_int, (int)-(int64_t)n->mantissa);
+            }
+            else if (n->mantissa <= (uint64_t)INT64_MAX + 1) {
+                r = JSON_PARSER_HANDLER(handler, on_int64,
+                                        (n->mantissa == (uint64_t)INT64_MAX + 1) ? INT64_MIN : -(int64_t)n->mantissa);
+            }
+            else {
+                r = JSON_PARSER_HANDLER(handler, on_double, json_number_to_double(n, str, len));
+            }
+        }
+        else if (n->mantissa <= INT_MAX) {
+            r = JSON_PARSER_HANDLER(handler, on_int, (int)n->mantissa);
+        }
+        else if (n->mantissa <= UINT_MAX) {
+            r = JSON_PARSER_HANDLER(handler, on_uint, (unsigned int)n->mantissa);
+        }
+        else if (n->mantissa <= INT64_MAX) {
+            r = JSON_PARSER_HANDLER(handler, on_int64, (int64_t)n->mantissa);
+        }
+        else {
+            r = JSON_PARSER_HANDLER(handler, on_uint64, n->mantissa);
+        }
+    }
+    else {
+        double d = json_number_to_double(n, str, len);
+
+        if (isinf(d)) {
+            return JSON_PARSER_ERROR_NUMBER_TOO_BIG;
+        }
+
+        r = JSON_PARSER_HANDLER(handler, on_double, d);
+    }
+
+    return r ? JSON_PARSER_ERROR_TERMINATION : JSON_PARSER_ERROR_OK;
+}
+
+
+#endif //_JSON_NUMBER_H_INCLUDED
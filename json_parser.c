@@ -1,561 +1,1496 @@
 #include "json_parser.h"
+#include "json_simd.h"
+#include "json_index.h"
+#include "json_number.h"
+#include "json_utf8.h"
+#include "json_path.h"
+#include "json_bind.h"
+#include "json_keys.h"
 #include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <string.h>
 #include <assert.h>
 
+#if JSON_PARSER_STATS
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
 
-static int
-json_read_value(struct json_stream_t *stream, struct json_parser_handler_t *handler);
-
-
-static int
-json_read_string_opt(struct json_stream_t *stream, struct json_parser_handler_t *handler, int is_key)
-{
-    if (JSON_PARSER_CONSUME(stream, '"')) {
-        return JSON_PARSER_ERROR_VALUE_INVALID;
-    }
+#ifdef JSON_PARSER_USDT
+#include <sys/sdt.h>
+#endif
 
-    char *head = JSON_PARSER_PUT_BEGIN(stream);
 
-    char c;
-    while (c = JSON_PARSER_TAKE(stream), '"' != c) {
+/* a json_read_path in progress; done has a bit per path */
+struct json_path_read_t {
+    const struct json_path_t *path;
+    struct json_path_handler_t *handler;
 
-        if ('\\' == c) {
-            c = JSON_PARSER_TAKE(stream);
-            switch (c) {
-            case '\\':
-            case '/':
-            case '"':
-                break;
-            case 'b':
-                c = '\b';
-                break;
-            case 'f':
-                c = '\f';
-                break;
-            case 'n':
-                c = '\n';
-                break;
-            case 'r':
-                c = '\r';
-                break;
-            case 't':
-                c = '\t';
-                break;
-            case 'u':
-            default:
-                return JSON_PARSER_ERROR_VALUE_INVALID;
-            }
-        }
+    size_t remaining;
+    uint64_t *done;
+};
 
-        JSON_PARSER_PUT(stream, c);
-    }
 
-    size_t length = JSON_PARSER_PUT_END(stream, head);
-    assert(length <= 0xFFFFFFFF);
+#define JSON_READ_SCOPES                64
 
-    if ((is_key ? handler->vtbl->on_key : handler->vtbl->on_string)(handler->ctx, head, length)) {
-        return JSON_PARSER_ERROR_TERMINATION;
-    }
 
-    return JSON_PARSER_ERROR_OK;
-}
+/* an object or array being read */
+struct json_read_scope_t {
+    int is_object;
+    size_t count;
+};
 
 
 static int
-json_read_object(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+json_read_grow(struct json_read_scope_t **stack, struct json_read_scope_t *local, size_t *capacity)
 {
-    if (JSON_PARSER_CONSUME(stream, '{')) {
-        return JSON_PARSER_ERROR_VALUE_INVALID;
+    struct json_read_scope_t *p = malloc(*capacity * 2 * sizeof(struct json_read_scope_t));
+    if (!p) {
+        return -1;
     }
 
-    if (JSON_PARSER_HANDLER(handler, on_start_object)) {
-        return JSON_PARSER_ERROR_TERMINATION;
+    memcpy(p, *stack, *capacity * sizeof(struct json_read_scope_t));
+
+    if (*stack != local) {
+        free(*stack);
     }
 
-    JSON_PARSER_SKIP_WS(stream);
+    *stack = p;
+    *capacity *= 2;
 
-    if (!JSON_PARSER_CONSUME(stream, '}')) {
-        if (JSON_PARSER_HANDLER(handler, on_end_object, 0)) {
-            return JSON_PARSER_ERROR_TERMINATION;
-        }
+    return 0;
+}
 
-        return JSON_PARSER_ERROR_OK;
+
+static inline int
+json_read_push(struct json_read_scope_t **stack, struct json_read_scope_t *local,
+               struct json_read_scope_t **top, size_t *capacity, int is_object)
+{
+    size_t depth = *top ? (size_t)(*top - *stack) + 1 : 0;
+
+    if ((depth == *capacity) && json_read_grow(stack, local, capacity)) {
+        return -1;
     }
 
-    size_t count = 0;
-    while (1) {
+    *top = *stack + depth;
+    (*top)->is_object = is_object;
+    (*top)->count = 0;
 
-        if (json_read_string_opt(stream, handler, 1)) {
-            return JSON_PARSER_ERROR_OBJECT_MISS_NAME;
-        }
+    return 0;
+}
 
-        JSON_PARSER_SKIP_WS(stream);
 
-        if (JSON_PARSER_CONSUME(stream, ':')) {
-            return JSON_PARSER_ERROR_OBJECT_MISS_COLON;
-        }
+#define JSON_READER_T                   struct json_stream_t
+#define JSON_READER_FN(name)            name##_stream
+#define JSON_READER_PEEK(stream)        JSON_PARSER_PEEK(stream)
+#define JSON_READER_TAKE(stream)        JSON_PARSER_TAKE(stream)
+#define JSON_READER_PUT_BEGIN(stream)   JSON_PARSER_PUT_BEGIN(stream)
+#define JSON_READER_PUT(stream, c)      JSON_PARSER_PUT(stream, c)
+#define JSON_READER_PUT_END(stream, begin)  JSON_PARSER_PUT_END(stream, begin)
 
-        JSON_PARSER_SKIP_WS(stream);
+#include "json_reader.h"
 
-        if (json_read_value(stream, handler)) {
-            return JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET;
-        }
+#undef JSON_READER_T
+#undef JSON_READER_FN
+#undef JSON_READER_PEEK
+#undef JSON_READER_TAKE
+#undef JSON_READER_PUT_BEGIN
+#undef JSON_READER_PUT
+#undef JSON_READER_PUT_END
 
-        JSON_PARSER_SKIP_WS(stream);
 
-        ++count;
+struct json_str_reader_t {
+    const char *src;
+    const char *tail;
+    size_t put;
+    const struct json_simd_vtbl_t *simd;
+};
 
-        switch (JSON_PARSER_PEEK(stream)) {
-        case ',':
-            JSON_PARSER_TAKE(stream);
-            JSON_PARSER_SKIP_WS(stream);
-            break;
-        case '}':
-            JSON_PARSER_TAKE(stream);
 
-            if (JSON_PARSER_HANDLER(handler, on_end_object, count)) {
-                return JSON_PARSER_ERROR_TERMINATION;
-            }
+static inline void
+json_str_reader_skip_ws(struct json_str_reader_t *r)
+{
+    const char *p = r->src;
 
-            return JSON_PARSER_ERROR_OK;
-        default:
-            return JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET;
-            break;
+    if ((p < r->tail) && JSON_PARSER_IS_WS(*p)) {
+        ++p;
+
+        if ((p < r->tail) && JSON_PARSER_IS_WS(*p)) {
+            p = r->simd->skip_ws(p + 1, r->tail);
         }
-    }
 
-    return JSON_PARSER_ERROR_OK;
+        r->src = p;
+    }
 }
 
 
-static int
-json_read_string(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+static inline void
+json_str_reader_put_span(struct json_str_reader_t *r)
 {
-    return json_read_string_opt(stream, handler, 0);
+    const char *p = r->simd->scan_string(r->src, r->tail);
+
+    r->put += p - r->src;
+    r->src = p;
 }
 
 
 static inline int
-json_read_null(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+json_str_reader_skip_container(struct json_str_reader_t *r)
 {
-    if (JSON_PARSER_CONSUME(stream, 'n')
-        || JSON_PARSER_CONSUME(stream, 'u')
-        || JSON_PARSER_CONSUME(stream, 'l')
-        || JSON_PARSER_CONSUME(stream, 'l')) {
+    const char *p = json_simd_skip_container(r->simd, r->src, r->tail, 0);
 
+    if (!p) {
         return JSON_PARSER_ERROR_VALUE_INVALID;
     }
 
-    if (JSON_PARSER_HANDLER(handler, on_null)) {
-        return JSON_PARSER_ERROR_TERMINATION;
-    }
+    r->src = p;
 
     return JSON_PARSER_ERROR_OK;
 }
 
 
-static inline int
-json_read_true(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+static inline void
+json_str_reader_digits(struct json_str_reader_t *r, struct json_number_t *n, int fraction)
 {
-    if (JSON_PARSER_CONSUME(stream, 't')
-        || JSON_PARSER_CONSUME(stream, 'r')
-        || JSON_PARSER_CONSUME(stream, 'u')
-        || JSON_PARSER_CONSUME(stream, 'e')) {
-
-        return JSON_PARSER_ERROR_VALUE_INVALID;
-    }
-
-    if (JSON_PARSER_HANDLER(handler, on_bool, 1)) {
-        return JSON_PARSER_ERROR_TERMINATION;
-    }
+    const char *p = json_number_scan_digits(n, r->src, r->tail, fraction);
 
-    return JSON_PARSER_ERROR_OK;
+    r->put += p - r->src;
+    r->src = p;
 }
 
 
-static inline int
-json_read_false(struct json_stream_t *stream, struct json_parser_handler_t *handler)
-{
-    if (JSON_PARSER_CONSUME(stream, 'f')
-        || JSON_PARSER_CONSUME(stream, 'a')
-        || JSON_PARSER_CONSUME(stream, 'l')
-        || JSON_PARSER_CONSUME(stream, 's')
-        || JSON_PARSER_CONSUME(stream, 'e')) {
+#define JSON_READER_T                   struct json_str_reader_t
+#define JSON_READER_FN(name)            name##_str
+#define JSON_READER_PEEK(r)                                         \
+    (((r)->src < (r)->tail) ? *(r)->src : (char)-1)
+#define JSON_READER_TAKE(r)                                         \
+    (((r)->src < (r)->tail) ? *(r)->src++ : (char)-1)
+#define JSON_READER_PUT_BEGIN(r)                                    \
+    ((r)->put = 0, (char *)(r)->src)
+#define JSON_READER_PUT(r, c)           ((void)(c), ++(r)->put)
+#define JSON_READER_PUT_END(r, begin)   ((void)(begin), (r)->put)
+#define JSON_READER_PUT_SPAN(r)         json_str_reader_put_span(r)
+#define JSON_READER_SKIP_WS(r)          json_str_reader_skip_ws(r)
+#define JSON_READER_DIGITS(r, n, fraction)  json_str_reader_digits(r, n, fraction)
+#define JSON_READER_SKIP_CONTAINER(r)   json_str_reader_skip_container(r)
 
-        return JSON_PARSER_ERROR_VALUE_INVALID;
-    }
+#include "json_reader.h"
 
-    if (JSON_PARSER_HANDLER(handler, on_bool, 0)) {
-        return JSON_PARSER_ERROR_TERMINATION;
-    }
+#undef JSON_READER_T
+#undef JSON_READER_FN
+#undef JSON_READER_PEEK
+#undef JSON_READER_TAKE
+#undef JSON_READER_PUT_BEGIN
+#undef JSON_READER_PUT
+#undef JSON_READER_PUT_END
 
-    return JSON_PARSER_ERROR_OK;
-}
+
+#define JSON_INDEX_CHAR(str, pos, last)                             \
+    (((pos) < (last)) ? (str)[*(pos)] : 0)
 
 
 static int
-json_read_number(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+json_read_index(struct json_str_reader_t *r, const char *str, const struct json_index_t *index,
+                struct json_parser_handler_t *handler)
 {
-    int minus = 1;
-    int a = 0;
-    int d = 0;
-    double f = 1;
-    int e = 0;
-    int e_minus = 1;
-
-    if (!JSON_PARSER_CONSUME(stream, '-')) {
-        minus = -1;
-    }
-
-    char c = JSON_PARSER_PEEK(stream);
-    if ('0' == c) {
-        JSON_PARSER_TAKE(stream);
-    }
-    else if ((c >= '1') && (c <= '9')) {
-        a = a * 10 + (c - '0');
-        JSON_PARSER_TAKE(stream);
+    struct json_read_scope_t local[JSON_READ_SCOPES];
+    struct json_read_scope_t *stack = local;
+    struct json_read_scope_t *top = NULL;
+    size_t capacity = JSON_READ_SCOPES;
+
+    const uint32_t *pos = index->pos;
+    const uint32_t *last = index->pos + index->count;
+
+    int adjacent = 1;
+    int ret = JSON_PARSER_ERROR_OK;
+
+value:
+    switch (JSON_INDEX_CHAR(str, pos, last)) {
+    case '{':
+        if (JSON_PARSER_HANDLER(handler, on_start_object)) {
+            ret = JSON_PARSER_ERROR_TERMINATION;
+            goto done;
+        }
 
-        while (c = JSON_PARSER_PEEK(stream), (c >= '0') && (c <= '9')) {
-            a = a * 10 + (c - '0');
-            JSON_PARSER_TAKE(stream);
+        if (json_read_push(&stack, local, &top, &capacity, 1)) {
+            ret = JSON_PARSER_ERROR_TERMINATION;
+            goto done;
         }
-    }
-    else {
-        return JSON_PARSER_ERROR_VALUE_INVALID;
-    }
 
-    c = JSON_PARSER_PEEK(stream);
-    if ('.' == c) {
-        JSON_PARSER_TAKE(stream);
+        ++pos;
 
-        while (c = JSON_PARSER_PEEK(stream), (c >= '0') && (c <= '9')) {
-            d = d * 10 + (c - '0');
-            f *= 0.1;
-            JSON_PARSER_TAKE(stream);
+        if ('}' == JSON_INDEX_CHAR(str, pos, last)) {
+            ++pos;
+            goto end_scope;
         }
-    }
 
-    c = JSON_PARSER_PEEK(stream);
-    if (('e' == c) || ('E' == c)) {
-        JSON_PARSER_TAKE(stream);
+        goto key;
 
-        e_minus = JSON_PARSER_CONSUME(stream, '-');
+    case '[':
+        if (JSON_PARSER_HANDLER(handler, on_start_array)) {
+            ret = JSON_PARSER_ERROR_TERMINATION;
+            goto done;
+        }
 
-        while (c = JSON_PARSER_PEEK(stream), (c >= '0') && (c <= '9')) {
-            e = e * 10 + (e - '0');
-            JSON_PARSER_TAKE(stream);
+        if (json_read_push(&stack, local, &top, &capacity, 0)) {
+            ret = JSON_PARSER_ERROR_TERMINATION;
+            goto done;
         }
-    }
 
-    if (d) {
-        f *= d;
-        f += a;
+        ++pos;
 
-        if (JSON_PARSER_HANDLER(handler, on_double, minus * f)) {
-            return JSON_PARSER_ERROR_TERMINATION;
+        if (']' == JSON_INDEX_CHAR(str, pos, last)) {
+            ++pos;
+            goto end_scope;
         }
-    }
-    else {
-        if (JSON_PARSER_HANDLER(handler, on_int, minus * a)) {
-            return JSON_PARSER_ERROR_TERMINATION;
+
+        goto value;
+
+    case '"':
+    case 't':
+    case 'f':
+    case 'n':
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        r->src = str + *pos;
+
+        if ((ret = json_read_scalar_str(r, handler))) {
+            goto done;
         }
+
+        json_str_reader_skip_ws(r);
+        adjacent = (r->src == str + pos[1]);
+        ++pos;
+
+        goto next;
+
+    default:
+        ret = JSON_PARSER_ERROR_VALUE_INVALID;
+        goto done;
     }
 
-    return JSON_PARSER_ERROR_OK;
-}
+key:
+    if ('"' != JSON_INDEX_CHAR(str, pos, last)) {
+        ret = JSON_PARSER_ERROR_OBJECT_MISS_NAME;
+        goto done;
+    }
 
+    r->src = str + *pos;
 
-static int
-json_read_array(struct json_stream_t *stream, struct json_parser_handler_t *handler)
-{
-    if (JSON_PARSER_CONSUME(stream, '[')) {
-        return JSON_PARSER_ERROR_VALUE_INVALID;
+    if ((ret = json_read_string_opt_str(r, handler, 1))) {
+        goto done;
     }
 
-    if (JSON_PARSER_HANDLER(handler, on_start_array)) {
-        return JSON_PARSER_ERROR_TERMINATION;
+    ++pos;
+
+    if (':' != JSON_INDEX_CHAR(str, pos, last)) {
+        ret = JSON_PARSER_ERROR_OBJECT_MISS_COLON;
+        goto done;
     }
 
-    JSON_PARSER_SKIP_WS(stream);
+    ++pos;
+    goto value;
 
-    if (!JSON_PARSER_CONSUME(stream, ']')) {
-        if (JSON_PARSER_HANDLER(handler, on_end_array, 0)) {
-            return JSON_PARSER_ERROR_TERMINATION;
-        }
+end_scope:
+    if (top->is_object
+        ? JSON_PARSER_HANDLER(handler, on_end_object, top->count)
+        : JSON_PARSER_HANDLER(handler, on_end_array, top->count)) {
 
-        return JSON_PARSER_ERROR_OK;
+        ret = JSON_PARSER_ERROR_TERMINATION;
+        goto done;
     }
 
-    size_t count = 0;
-    while (1) {
+    top = (top == stack) ? NULL : top - 1;
+    adjacent = 1;
 
-        if (json_read_value(stream, handler)) {
-            return JSON_PARSER_ERROR_VALUE_INVALID;
-        }
+next:
+    if (!top) {
+        goto done;
+    }
 
-        ++count;
+    ++top->count;
 
-        JSON_PARSER_SKIP_WS(stream);
+    switch (adjacent ? JSON_INDEX_CHAR(str, pos, last) : 0) {
+    case ',':
+        ++pos;
 
-        if (!JSON_PARSER_CONSUME(stream, ']')) {
-            if (JSON_PARSER_HANDLER(handler, on_end_array, count)) {
-                return JSON_PARSER_ERROR_TERMINATION;
-            }
+        if (top->is_object) {
+            goto key;
+        }
 
-            return JSON_PARSER_ERROR_OK;
+        goto value;
+
+    case '}':
+        if (top->is_object) {
+            ++pos;
+            goto end_scope;
         }
+        break;
 
-        if (JSON_PARSER_CONSUME(stream, ',')) {
-            return JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+    case ']':
+        if (!top->is_object) {
+            ++pos;
+            goto end_scope;
         }
+        break;
+    }
 
-        JSON_PARSER_SKIP_WS(stream);
+    ret = top->is_object
+        ? JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET
+        : JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+
+done:
+    if (stack != local) {
+        free(stack);
     }
 
-    return JSON_PARSER_ERROR_OK;
+    return ret;
 }
 
 
-static int
-json_read_value(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+int
+json_read(struct json_stream_t *stream, struct json_parser_handler_t *handler)
 {
-    switch (JSON_PARSER_PEEK(stream)) {
+    JSON_PARSER_SKIP_WS(stream);
+    return json_read_value_stream(stream, handler);
+}
 
-        case '"':
-            return json_read_string(stream, handler);
 
-        case '{':
-            return json_read_object(stream, handler);
+/* json_read_str with the index, if the input gets one, built in index */
+static int
+json_read_str_with(const char *str, size_t len, struct json_parser_handler_t *handler, struct json_index_t *index)
+{
+    struct json_str_reader_t r;
 
-        case '[':
-            return json_read_array(stream, handler);
-
-        case 't':
-            return json_read_true(stream, handler);
-
-        case 'f':
-            return json_read_false(stream, handler);
-
-        case 'n':
-            return json_read_null(stream, handler);
-
-        case '-':
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            return json_read_number(stream, handler);
+    r.src = str;
+    r.tail = str + len;
+    r.put = 0;
+    r.simd = json_simd();
 
-        default:
-            return JSON_PARSER_ERROR_VALUE_INVALID;
+    if ((len >= JSON_PARSER_INDEX_THRESHOLD) && !json_index_build(index, str, len)) {
+        return json_read_index(&r, str, index, handler);
     }
 
-    assert(0);
+    json_str_reader_skip_ws(&r);
+
+    return json_read_value_str(&r, handler);
 }
 
 
 int
-json_read(struct json_stream_t *stream, struct json_parser_handler_t *handler)
+json_read_str(const char *str, size_t len, struct json_parser_handler_t *handler)
 {
-    JSON_PARSER_SKIP_WS(stream);
-    return json_read_value(stream, handler);
+    struct json_index_t index;
+    json_index_init(&index);
+
+    int ret = json_read_str_with(str, len, handler, &index);
+
+    json_index_free(&index);
+
+    return ret;
 }
 
 
-static inline struct json_value_t *
-json_parser_add_value(struct json_parser_t *parser, enum json_value_type_t type)
+#define JSON_PATH_LOCAL_TARGETS         256
+
+
+int
+json_read_path(struct json_stream_t *stream, const struct json_path_t *path,
+               struct json_path_handler_t *handler)
 {
-    struct json_value_t *p = json_value_add(parser->a, parser->current, type);
+    uint64_t local[JSON_PATH_LOCAL_TARGETS / 64];
+    struct json_path_read_t s;
+    size_t words = (path->count + 63) / 64;
 
-    if (!parser->root) {
-        parser->root = p;
+    if (!path->count) {
+        return JSON_PARSER_ERROR_OK;
     }
 
-    return p;
-}
+    s.path = path;
+    s.handler = handler;
+    s.remaining = path->count;
+    s.done = (path->count > JSON_PATH_LOCAL_TARGETS) ? malloc(words * sizeof(uint64_t)) : local;
 
+    if (!s.done) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
 
-static int
-json_parser_on_null(void *ctx)
-{
-    struct json_parser_t *parser = ctx;
-    json_parser_add_value(parser, JSON_VALUE_TYPE_NULL);
+    memset(s.done, 0, words * sizeof(uint64_t));
 
-    return 0;
+    JSON_PARSER_SKIP_WS(stream);
+
+    int ret = json_read_path_value_stream(stream, &s, 0);
+
+    if (s.done != local) {
+        free(s.done);
+    }
+
+    return ret;
 }
 
 
-static int
-json_parser_on_bool(void *ctx, int b)
+int
+json_read_path_str(const char *str, size_t len, const struct json_path_t *path,
+                   struct json_path_handler_t *handler)
 {
-    struct json_parser_t *parser = ctx;
+    uint64_t local[JSON_PATH_LOCAL_TARGETS / 64];
+    struct json_path_read_t s;
+    struct json_str_reader_t r;
+    size_t words = (path->count + 63) / 64;
 
-    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_BOOL);
-    assert(p);
+    if (!path->count) {
+        return JSON_PARSER_ERROR_OK;
+    }
 
-    p->b = !!b;
+    s.path = path;
+    s.handler = handler;
+    s.remaining = path->count;
+    s.done = (path->count > JSON_PATH_LOCAL_TARGETS) ? malloc(words * sizeof(uint64_t)) : local;
 
-    return 0;
-}
+    if (!s.done) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
 
+    memset(s.done, 0, words * sizeof(uint64_t));
 
-static int
-json_parser_on_int(void *ctx, int i)
-{
-    struct json_parser_t *parser = ctx;
+    r.src = str;
+    r.tail = str + len;
+    r.put = 0;
+    r.simd = json_simd();
 
-    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_INT);
-    assert(p);
+    json_str_reader_skip_ws(&r);
 
-    p->i = i;
+    int ret = json_read_path_value_str(&r, &s, 0);
 
-    return 0;
+    if (s.done != local) {
+        free(s.done);
+    }
+
+    return ret;
 }
 
 
+struct json_bind_scalar_t {
+    enum json_bind_type_t type;
+    void *dst;
+    int error;
+};
+
+
 static int
-json_parser_on_uint(void *ctx, unsigned int i)
+json_bind_mismatch(struct json_bind_scalar_t *s)
 {
+    s->error = JSON_PARSER_ERROR_BIND_MISMATCH;
     return -1;
 }
 
 
 static int
-json_parser_on_int64(void *ctx, int64_t i)
+json_bind_store_int64(struct json_bind_scalar_t *s, int64_t i)
 {
-    return -1;
+    switch (s->type) {
+    case JSON_BIND_TYPE_INT:
+        if ((i < INT_MIN) || (i > INT_MAX)) {
+            return json_bind_mismatch(s);
+        }
+        *(int *)s->dst = (int)i;
+        return 0;
+    case JSON_BIND_TYPE_INT64:
+        *(int64_t *)s->dst = i;
+        return 0;
+    case JSON_BIND_TYPE_UINT64:
+        if (i < 0) {
+            return json_bind_mismatch(s);
+        }
+        *(uint64_t *)s->dst = (uint64_t)i;
+        return 0;
+    case JSON_BIND_TYPE_DOUBLE:
+        *(double *)s->dst = (double)i;
+        return 0;
+    default:
+        return json_bind_mismatch(s);
+    }
 }
 
 
 static int
-json_parser_on_uint64(void *ctx, uint64_t i)
+json_bind_store_uint64(struct json_bind_scalar_t *s, uint64_t u)
 {
-    return -1;
+    switch (s->type) {
+    case JSON_BIND_TYPE_UINT64:
+        *(uint64_t *)s->dst = u;
+        return 0;
+    case JSON_BIND_TYPE_DOUBLE:
+        *(double *)s->dst = (double)u;
+        return 0;
+    default:
+        if (u > INT64_MAX) {
+            return json_bind_mismatch(s);
+        }
+        return json_bind_store_int64(s, (int64_t)u);
+    }
 }
 
 
 static int
-json_parser_on_double(void *ctx, double d)
+json_bind_on_null(void *ctx)
 {
-    struct json_parser_t *parser = ctx;
-
-    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_DOUBLE);
-    assert(p);
-
-    p->d = d;
-
     return 0;
 }
 
 
 static int
-json_parser_on_string(void *ctx, const char *str, size_t len)
+json_bind_on_bool(void *ctx, int b)
 {
-    struct json_parser_t *parser = ctx;
+    struct json_bind_scalar_t *s = ctx;
 
-    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_STRING);
-    assert(p);
+    if (JSON_BIND_TYPE_BOOL != s->type) {
+        return json_bind_mismatch(s);
+    }
 
-    p->str.data = (char *)str;
-    p->str.len = len;
+    *(int *)s->dst = b;
 
     return 0;
 }
 
 
 static int
-json_parser_on_key(void *ctx, const char *str, size_t len)
+json_bind_on_int(void *ctx, int i)
 {
-    struct json_parser_t *parser = ctx;
+    return json_bind_store_int64(ctx, i);
+}
 
-    json_value_add_key(parser->a, parser->current, (char *)str, len);
 
-    return 0;
+static int
+json_bind_on_uint(void *ctx, unsigned int i)
+{
+    return json_bind_store_uint64(ctx, i);
 }
 
 
 static int
-json_parser_on_start_object(void *ctx)
+json_bind_on_int64(void *ctx, int64_t i)
 {
-    struct json_parser_t *parser = ctx;
+    return json_bind_store_int64(ctx, i);
+}
 
-    if ((parser->depth + 1) > parser->max_depth) {
-        return -1;
-    }
 
-    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_OBJECT);
-    assert(p);
+static int
+json_bind_on_uint64(void *ctx, uint64_t i)
+{
+    return json_bind_store_uint64(ctx, i);
+}
+
 
-    p->obj.size = 0;
-    p->obj.head = p->obj.tail = NULL;
+static int
+json_bind_on_double(void *ctx, double d)
+{
+    struct json_bind_scalar_t *s = ctx;
 
-    parser->current = p;
+    if (JSON_BIND_TYPE_DOUBLE != s->type) {
+        return json_bind_mismatch(s);
+    }
 
-    ++parser->depth;
+    *(double *)s->dst = d;
 
     return 0;
 }
 
 
 static int
-json_parser_on_end_object(void *ctx, size_t count)
+json_bind_on_string(void *ctx, const char *str, size_t len)
 {
-    struct json_parser_t *parser = ctx;
-    struct json_value_t *v = parser->current;
+    return json_bind_mismatch(ctx);
+}
 
-    parser->current = v->parent;
 
-    return 0;
+static int
+json_bind_on_start(void *ctx)
+{
+    return json_bind_mismatch(ctx);
 }
 
+
 static int
-json_parser_on_start_array(void *ctx)
+json_bind_on_end(void *ctx, size_t count)
 {
-    struct json_parser_t *parser = ctx;
+    return json_bind_mismatch(ctx);
+}
 
-    if ((parser->depth + 1) > parser->max_depth) {
-        return -1;
-    }
 
-    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_ARRAY);
-    assert(p);
+/* scalars only: strings and containers are bound before they reach a handler */
+static struct json_parser_handler_vtbl_t
+json_bind_scalar_vtbl = {
+    &json_bind_on_null,
+    &json_bind_on_bool,
+    &json_bind_on_int,
+    &json_bind_on_uint,
+    &json_bind_on_int64,
+    &json_bind_on_uint64,
+    &json_bind_on_double,
+    &json_bind_on_string,
+    &json_bind_on_string,
+    &json_bind_on_start,
+    &json_bind_on_end,
+    &json_bind_on_start,
+    &json_bind_on_end
+};
 
-    p->arr.size = 0;
-    p->arr.head = p->arr.tail = NULL;
 
-    parser->current = p;
+static size_t
+json_bind_size(const struct json_bind_field_t *f)
+{
+    switch (f->type) {
+    case JSON_BIND_TYPE_INT64:
+        return sizeof(int64_t);
+    case JSON_BIND_TYPE_UINT64:
+        return sizeof(uint64_t);
+    case JSON_BIND_TYPE_DOUBLE:
+        return sizeof(double);
+    case JSON_BIND_TYPE_STRING:
+        return sizeof(struct json_string_t);
+    case JSON_BIND_TYPE_OBJECT:
+        return f->bind->size;
+    default:
+        return sizeof(int);
+    }
+}
 
-    ++parser->depth;
 
-    return 0;
+static inline char
+json_bind_peek(const struct json_str_reader_t *r)
+{
+    return (r->src < r->tail) ? *r->src : (char)-1;
 }
 
+
 static int
-json_parser_on_end_array(void *ctx, size_t count)
+json_bind_scalar(struct json_str_reader_t *r, enum json_bind_type_t type, void *dst)
 {
-    struct json_parser_t *parser = ctx;
-    struct json_value_t *v = parser->current;
+    struct json_bind_scalar_t s = { type, dst, 0 };
+    struct json_parser_handler_t h = { &json_bind_scalar_vtbl, &s };
 
-    parser->current = v->parent;
+    int ret = json_read_value_str(r, &h);
 
-    return 0;
+    return s.error ? s.error : ret;
 }
 
 
-static struct json_parser_handler_vtbl_t 
-json_parser_handler_vtbl = {
-    &json_parser_on_null,
-    &json_parser_on_bool,
-    &json_parser_on_int,
-    &json_parser_on_uint,
-    &json_parser_on_int64,
-    &json_parser_on_uint64,
+static int
+json_bind_object(struct json_str_reader_t *r, const struct json_bind_t *b, char *base);
+
+
+static int
+json_bind_value(struct json_str_reader_t *r, const struct json_bind_field_t *f, char *dst)
+{
+    struct json_string_t *str;
+
+    switch (json_bind_peek(r)) {
+    case '{':
+        if (JSON_BIND_TYPE_OBJECT != f->type) {
+            return JSON_PARSER_ERROR_BIND_MISMATCH;
+        }
+        return json_bind_object(r, f->bind, dst);
+    case '[':
+        return JSON_PARSER_ERROR_BIND_MISMATCH;
+    case '"':
+        if (JSON_BIND_TYPE_STRING != f->type) {
+            return JSON_PARSER_ERROR_BIND_MISMATCH;
+        }
+        str = (struct json_string_t *)dst;
+        return json_scan_string_str(r, &str->data, &str->len);
+    default:
+        return json_bind_scalar(r, f->type, dst);
+    }
+}
+
+
+static int
+json_bind_array(struct json_str_reader_t *r, const struct json_bind_field_t *f, char *base)
+{
+    size_t *count = (size_t *)(base + f->count);
+    size_t size = json_bind_size(f);
+    char *dst = base + f->offset;
+    int ret;
+
+    *count = 0;
+
+    if ('[' != json_bind_peek(r)) {
+        /* null, or a mismatch whatever type is given */
+        return json_bind_scalar(r, JSON_BIND_TYPE_OBJECT, NULL);
+    }
+
+    ++r->src;
+    json_str_reader_skip_ws(r);
+
+    if (']' == json_bind_peek(r)) {
+        ++r->src;
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    while (1) {
+        if (*count == f->capacity) {
+            return JSON_PARSER_ERROR_BIND_MISMATCH;
+        }
+
+        memset(dst, 0, size);
+
+        if ((ret = json_bind_value(r, f, dst))) {
+            return ret;
+        }
+
+        ++*count;
+        dst += size;
+
+        json_str_reader_skip_ws(r);
+
+        switch (json_bind_peek(r)) {
+        case ',':
+            ++r->src;
+            json_str_reader_skip_ws(r);
+            break;
+        case ']':
+            ++r->src;
+            return JSON_PARSER_ERROR_OK;
+        default:
+            return JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+    }
+}
+
+
+static int
+json_bind_object(struct json_str_reader_t *r, const struct json_bind_t *b, char *base)
+{
+    int ret;
+
+    ++r->src;
+    json_str_reader_skip_ws(r);
+
+    if ('}' == json_bind_peek(r)) {
+        ++r->src;
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    while (1) {
+        const struct json_bind_field_t *f;
+        char *key;
+        size_t len;
+
+        if ('"' != json_bind_peek(r)) {
+            return JSON_PARSER_ERROR_OBJECT_MISS_NAME;
+        }
+
+        if ((ret = json_scan_string_str(r, &key, &len))) {
+            return ret;
+        }
+
+        f = json_bind_find(b, key, r->src - 1 - key, len);
+
+        json_str_reader_skip_ws(r);
+
+        if (':' != json_bind_peek(r)) {
+            return JSON_PARSER_ERROR_OBJECT_MISS_COLON;
+        }
+
+        ++r->src;
+        json_str_reader_skip_ws(r);
+
+        if (!f) {
+            ret = json_skip_value_str(r);
+        }
+        else if (f->capacity) {
+            ret = json_bind_array(r, f, base);
+        }
+        else {
+            ret = json_bind_value(r, f, base + f->offset);
+        }
+
+        if (ret) {
+            return ret;
+        }
+
+        json_str_reader_skip_ws(r);
+
+        switch (json_bind_peek(r)) {
+        case ',':
+            ++r->src;
+            json_str_reader_skip_ws(r);
+            break;
+        case '}':
+            ++r->src;
+            return JSON_PARSER_ERROR_OK;
+        default:
+            return JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET;
+        }
+    }
+}
+
+
+int
+json_bind_str(const char *str, size_t len, const struct json_bind_t *b, void *out)
+{
+    struct json_str_reader_t r;
+
+    memset(out, 0, b->size);
+
+    r.src = str;
+    r.tail = str + len;
+    r.put = 0;
+    r.simd = json_simd();
+
+    json_str_reader_skip_ws(&r);
+
+    if ('{' != json_bind_peek(&r)) {
+        return json_bind_scalar(&r, JSON_BIND_TYPE_OBJECT, NULL);
+    }
+
+    return json_bind_object(&r, b, out);
+}
+
+
+#if JSON_PARSER_STATS
+static inline uint64_t
+json_parser_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return 0;
+#endif
+}
+
+
+static inline uint64_t
+json_parser_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void *
+json_parser_stats_on_alloc(void *ctx, size_t size)
+{
+    struct json_parser_t *parser = ctx;
+
+    ++parser->stats->allocs;
+    parser->stats->alloc_bytes += size;
+
+    return parser->a->vtbl->on_alloc(parser->a->ctx, size);
+}
+
+
+static void
+json_parser_stats_on_free(void *ctx, void *p)
+{
+    struct json_parser_t *parser = ctx;
+    parser->a->vtbl->on_free(parser->a->ctx, p);
+}
+
+
+/* counts, then hands over to parser->a */
+static struct json_allocator_vtbl_t
+json_parser_stats_allocator_vtbl = {
+    &json_parser_stats_on_alloc,
+    &json_parser_stats_on_free,
+    NULL
+};
+#endif
+
+
+static void
+json_parser_stats_begin(struct json_parser_t *parser)
+{
+#if JSON_PARSER_STATS
+    if (parser->stats) {
+        parser->stats_allocator.vtbl = &json_parser_stats_allocator_vtbl;
+        parser->stats_allocator.ctx = parser;
+
+        parser->stats_nsec = json_parser_nsec();
+        parser->stats_cycles = json_parser_cycles();
+        parser->stats_mallocs = parser->arena.mallocs;
+    }
+#endif
+
+#ifdef JSON_PARSER_USDT
+    DTRACE_PROBE1(json, parse_start, parser);
+#endif
+}
+
+
+static void
+json_parser_stats_end(struct json_parser_t *parser, int r)
+{
+#if JSON_PARSER_STATS
+    struct json_parser_stats_t *stats = parser->stats;
+
+    if (stats) {
+        ++stats->parses;
+        stats->errors += (JSON_PARSER_ERROR_OK != r);
+
+        stats->nsec += json_parser_nsec() - parser->stats_nsec;
+        stats->cycles += json_parser_cycles() - parser->stats_cycles;
+        stats->heap_allocs += parser->arena.mallocs - parser->stats_mallocs;
+    }
+#endif
+
+#ifdef JSON_PARSER_USDT
+#if JSON_PARSER_STATS
+    DTRACE_PROBE3(json, parse_end, parser, r, stats);
+#else
+    DTRACE_PROBE3(json, parse_end, parser, r, NULL);
+#endif
+#endif
+}
+
+
+/* what the DOM builder allocates through */
+static inline struct json_allocator_t *
+json_parser_allocator(struct json_parser_t *parser)
+{
+#if JSON_PARSER_STATS
+    if (parser->stats) {
+        return &parser->stats_allocator;
+    }
+#endif
+
+    return parser->a;
+}
+
+
+static inline void
+json_parser_count_string(struct json_parser_t *parser, const char *str, size_t len)
+{
+#if JSON_PARSER_STATS
+    if (parser->stats) {
+        parser->stats->string_bytes += len;
+
+        /* the first escape, if any, is within the first len bytes of the source */
+        if (memchr(str, '\\', len)) {
+            parser->stats->string_bytes_escaped += len;
+        }
+    }
+#endif
+}
+
+
+static struct json_object_elt_t *
+json_parser_push(struct json_parser_t *parser)
+{
+    if (parser->stack_size == parser->stack_capacity) {
+        size_t capacity = parser->stack_capacity ? parser->stack_capacity * 2 : 64;
+
+        struct json_object_elt_t *stack = realloc(parser->stack, capacity * sizeof(struct json_object_elt_t));
+        if (!stack) {
+            return NULL;
+        }
+
+        JSON_PARSER_COUNT(parser, heap_allocs, 1);
+
+        parser->stack = stack;
+        parser->stack_capacity = capacity;
+    }
+
+    return &parser->stack[parser->stack_size++];
+}
+
+
+static inline struct json_value_t *
+json_parser_add_value(struct json_parser_t *parser, enum json_value_type_t type)
+{
+    struct json_object_elt_t *elt;
+
+    if (parser->depth
+        && (JSON_VALUE_TYPE_OBJECT == parser->stack[parser->frames[parser->depth - 1] - 1].val.type)) {
+
+        elt = &parser->stack[parser->stack_size - 1];
+    }
+    else {
+        if (!(elt = json_parser_push(parser))) {
+            return NULL;
+        }
+
+        elt->key.data = NULL;
+        elt->key.len = 0;
+    }
+
+    elt->val.type = type;
+    elt->val.parent = NULL;
+
+    JSON_PARSER_COUNT(parser, values[type], 1);
+
+    return &elt->val;
+}
+
+
+static int
+json_parser_start_container(struct json_parser_t *parser, enum json_value_type_t type)
+{
+    if ((parser->depth + 1) > parser->max_depth) {
+        return -1;
+    }
+
+    if (parser->depth == parser->frames_capacity) {
+        size_t capacity = parser->frames_capacity ? parser->frames_capacity * 2 : 16;
+
+        size_t *frames = realloc(parser->frames, capacity * sizeof(size_t));
+        if (!frames) {
+            return -1;
+        }
+
+        JSON_PARSER_COUNT(parser, heap_allocs, 1);
+
+        parser->frames = frames;
+        parser->frames_capacity = capacity;
+    }
+
+    struct json_value_t *p = json_parser_add_value(parser, type);
+    if (!p) {
+        return -1;
+    }
+
+    if (JSON_VALUE_TYPE_OBJECT == type) {
+        p->obj.elts = NULL;
+        p->obj.size = p->obj.capacity = 0;
+        p->obj.index = NULL;
+    }
+    else {
+        p->arr.elts = NULL;
+        p->arr.size = p->arr.capacity = 0;
+    }
+
+    parser->frames[parser->depth++] = parser->stack_size;
+
+#if JSON_PARSER_STATS
+    if (parser->stats && (parser->depth > parser->stats->max_depth)) {
+        parser->stats->max_depth = parser->depth;
+    }
+#endif
+
+    return 0;
+}
+
+
+static int
+json_parser_end_container(struct json_parser_t *parser, size_t count)
+{
+    size_t mark = parser->frames[--parser->depth];
+    struct json_object_elt_t *children = parser->stack + mark;
+    struct json_value_t *v = &parser->stack[mark - 1].val;
+    struct json_allocator_t *a = json_parser_allocator(parser);
+    size_t i;
+
+    assert(count == parser->stack_size - mark);
+
+    if (!count) {
+        return 0;
+    }
+
+    if (JSON_VALUE_TYPE_OBJECT == v->type) {
+        struct json_object_elt_t *elts = a->vtbl->on_alloc(a->ctx, count * sizeof(struct json_object_elt_t));
+        if (!elts) {
+            return -1;
+        }
+
+        memcpy(elts, children, count * sizeof(struct json_object_elt_t));
+
+        for (i = 0; i < count; ++i) {
+            json_value_adopt(&elts[i].val);
+        }
+
+        v->obj.elts = elts;
+        v->obj.size = v->obj.capacity = count;
+
+        if (json_object_index(a, v)) {
+            return -1;
+        }
+    }
+    else {
+        struct json_value_t *elts = a->vtbl->on_alloc(a->ctx, count * sizeof(struct json_value_t));
+        if (!elts) {
+            return -1;
+        }
+
+        for (i = 0; i < count; ++i) {
+            elts[i] = children[i].val;
+            json_value_adopt(&elts[i]);
+        }
+
+        v->arr.elts = elts;
+        v->arr.size = v->arr.capacity = count;
+    }
+
+    parser->stack_size = mark;
+
+    return 0;
+}
+
+
+static int
+json_parser_finish(struct json_parser_t *parser)
+{
+    assert(1 == parser->stack_size && !parser->depth);
+
+    struct json_allocator_t *a = json_parser_allocator(parser);
+
+    struct json_value_t *root = a->vtbl->on_alloc(a->ctx, sizeof(struct json_value_t));
+    if (!root) {
+        return -1;
+    }
+
+    *root = parser->stack[0].val;
+    json_value_adopt(root);
+
+    parser->root = root;
+    parser->stack_size = 0;
+
+    return 0;
+}
+
+
+static void
+json_parser_reset(struct json_parser_t *parser)
+{
+    int reuse = parser->flags & JSON_PARSER_REUSE;
+
+    if (reuse && (parser->a == &parser->arena_allocator)) {
+        /* the tree lives in the arena and nowhere else */
+        json_arena_rewind(&parser->arena);
+    }
+    else if (parser->a->vtbl->on_reset) {
+        parser->a->vtbl->on_reset(parser->a->ctx);
+    }
+    else {
+        /* a closed container still on the stack has yet to adopt its children */
+        for (size_t i = 0; i < parser->stack_size; ++i) {
+            json_value_adopt(&parser->stack[i].val);
+            json_value_free(parser->a, &parser->stack[i].val, 1);
+        }
+
+        if (parser->root) {
+            json_value_free(parser->a, parser->root, 0);
+        }
+    }
+
+    if (parser->a != &parser->arena_allocator) {
+        if (reuse) {
+            json_arena_rewind(&parser->arena);
+        }
+        else {
+            json_arena_release(&parser->arena);
+        }
+    }
+
+    if (parser->map) {
+        munmap(parser->map, parser->map_size);
+        parser->map = NULL;
+        parser->map_size = 0;
+    }
+
+    parser->root = NULL;
+    parser->stack_size = 0;
+    parser->depth = 0;
+}
+
+
+void
+json_parser_clear(struct json_parser_t *parser)
+{
+    if (parser->a) {
+        json_parser_reset(parser);
+    }
+
+    /* all of it, rewound or not */
+    json_arena_release(&parser->arena);
+    json_arena_init(&parser->arena, 0);
+
+    free(parser->stack);
+    parser->stack = NULL;
+    parser->stack_capacity = 0;
+
+    free(parser->frames);
+    parser->frames = NULL;
+    parser->frames_capacity = 0;
+
+    json_index_free(&parser->index);
+}
+
+
+static int
+json_parser_on_null(void *ctx)
+{
+    struct json_parser_t *parser = ctx;
+
+    return json_parser_add_value(parser, JSON_VALUE_TYPE_NULL) ? 0 : -1;
+}
+
+
+static int
+json_parser_on_bool(void *ctx, int b)
+{
+    struct json_parser_t *parser = ctx;
+
+    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_BOOL);
+    if (!p) {
+        return -1;
+    }
+
+    p->b = !!b;
+
+    return 0;
+}
+
+
+static int
+json_parser_on_int(void *ctx, int i)
+{
+    struct json_parser_t *parser = ctx;
+
+    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_INT);
+    if (!p) {
+        return -1;
+    }
+
+    p->i = i;
+
+    return 0;
+}
+
+
+static int
+json_parser_on_int64(void *ctx, int64_t i)
+{
+    struct json_parser_t *parser = ctx;
+
+    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_INT64);
+    if (!p) {
+        return -1;
+    }
+
+    p->i64 = i;
+
+    return 0;
+}
+
+
+static int
+json_parser_on_uint(void *ctx, unsigned int i)
+{
+    return json_parser_on_int64(ctx, i);
+}
+
+
+static int
+json_parser_on_uint64(void *ctx, uint64_t i)
+{
+    struct json_parser_t *parser = ctx;
+
+    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_UINT64);
+    if (!p) {
+        return -1;
+    }
+
+    p->u64 = i;
+
+    return 0;
+}
+
+
+static int
+json_parser_on_double(void *ctx, double d)
+{
+    struct json_parser_t *parser = ctx;
+
+    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_DOUBLE);
+    if (!p) {
+        return -1;
+    }
+
+    p->d = d;
+
+    return 0;
+}
+
+
+static int
+json_parser_keep_string(struct json_parser_t *parser, struct json_string_t *s, const char *str, size_t len)
+{
+    s->data = (char *)str;
+    s->len = len;
+
+    if (!(parser->flags & JSON_PARSER_COPY_STRINGS)) {
+        return 0;
+    }
+
+    size_t size = json_string_raw_size(s);
+    if (!size) {
+        s->data = "";
+        return 0;
+    }
+
+    /* json_value_free leaves strings alone, so copies live in the parser's own arena */
+    char *p = json_arena_alloc(&parser->arena, size);
+    if (!p) {
+        return -1;
+    }
+
+    memcpy(p, str, size);
+    s->data = p;
+
+    JSON_PARSER_COUNT(parser, string_bytes_copied, len);
+
+    return 0;
+}
+
+
+int
+json_utf8_validate(const char *str, size_t len)
+{
+    return json_simd()->validate_utf8(str, str + len) ? JSON_PARSER_ERROR_STRING_INVALID_ENCODING
+                                                      : JSON_PARSER_ERROR_OK;
+}
+
+
+/*
+ * escapes are ASCII and \u ones decode to whole code points, so the
+ * source bytes of a string are valid UTF-8 just when its own are.
+ */
+static int
+json_parser_check_string(struct json_parser_t *parser, const char *str, size_t len)
+{
+    if (!(parser->flags & JSON_PARSER_VALIDATE_UTF8)) {
+        return 0;
+    }
+
+    struct json_string_t s = { (char *)str, len };
+    size_t size = memchr(str, '\\', len) ? json_string_raw_size(&s) : len;
+
+    if (json_utf8_validate(str, size)) {
+        parser->error = JSON_PARSER_ERROR_STRING_INVALID_ENCODING;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+json_parser_on_string(void *ctx, const char *str, size_t len)
+{
+    struct json_parser_t *parser = ctx;
+
+    if (json_parser_check_string(parser, str, len)) {
+        return -1;
+    }
+
+    struct json_value_t *p = json_parser_add_value(parser, JSON_VALUE_TYPE_STRING);
+    if (!p) {
+        return -1;
+    }
+
+    json_parser_count_string(parser, str, len);
+
+    return json_parser_keep_string(parser, &p->str, str, len);
+}
+
+
+static int
+json_parser_on_key(void *ctx, const char *str, size_t len)
+{
+    struct json_parser_t *parser = ctx;
+
+    if (json_parser_check_string(parser, str, len)) {
+        return -1;
+    }
+
+    struct json_object_elt_t *elt = json_parser_push(parser);
+    if (!elt) {
+        return -1;
+    }
+
+    elt->val.type = JSON_VALUE_TYPE_NONE;
+
+    JSON_PARSER_COUNT(parser, keys, 1);
+    json_parser_count_string(parser, str, len);
+
+    if (parser->keys) {
+        const struct json_string_t *key = json_keys_intern(parser->keys, str, len);
+
+        if (key) {
+            elt->key = *key;
+            JSON_PARSER_COUNT(parser, string_bytes_copied, len);
+            return 0;
+        }
+    }
+
+    return json_parser_keep_string(parser, &elt->key, str, len);
+}
+
+
+static int
+json_parser_on_start_object(void *ctx)
+{
+    struct json_parser_t *parser = ctx;
+    return json_parser_start_container(parser, JSON_VALUE_TYPE_OBJECT);
+}
+
+
+static int
+json_parser_on_end_object(void *ctx, size_t count)
+{
+    struct json_parser_t *parser = ctx;
+    return json_parser_end_container(parser, count);
+}
+
+
+static int
+json_parser_on_start_array(void *ctx)
+{
+    struct json_parser_t *parser = ctx;
+    return json_parser_start_container(parser, JSON_VALUE_TYPE_ARRAY);
+}
+
+
+static int
+json_parser_on_end_array(void *ctx, size_t count)
+{
+    struct json_parser_t *parser = ctx;
+    return json_parser_end_container(parser, count);
+}
+
+
+static struct json_parser_handler_vtbl_t 
+json_parser_handler_vtbl = {
+    &json_parser_on_null,
+    &json_parser_on_bool,
+    &json_parser_on_int,
+    &json_parser_on_uint,
+    &json_parser_on_int64,
+    &json_parser_on_uint64,
     &json_parser_on_double,
     &json_parser_on_key,
     &json_parser_on_string,
@@ -566,62 +1501,85 @@ json_parser_handler_vtbl = {
 };
 
 
-static void *
-json_parser_on_alloc(void *ctx, size_t size)
+/* json_parser_begin for a parse that is counted already */
+static void
+json_parser_restart(struct json_parser_t *parser, struct json_parser_handler_t *h)
 {
-    return malloc(size);
+    json_parser_reset(parser);
+
+    parser->error = JSON_PARSER_ERROR_OK;
+
+    h->vtbl = &json_parser_handler_vtbl;
+    h->ctx = parser;
 }
 
 
-static void
-json_parser_on_free(void *ctx, void *p)
+void
+json_parser_begin(struct json_parser_t *parser, struct json_parser_handler_t *h)
 {
-    free(p);
+    if (!parser->a) {
+        json_parser_init(parser, parser->max_depth, NULL);
+    }
+
+    json_parser_restart(parser, h);
+    json_parser_stats_begin(parser);
 }
 
 
-static struct json_allocator_vtbl_t
-json_parser_allocator_vtbl = {
-    &json_parser_on_alloc,
-    &json_parser_on_free
-};
+int
+json_parser_end(struct json_parser_t *parser, int r)
+{
+    if ((JSON_PARSER_ERROR_OK == r) && json_parser_finish(parser)) {
+        r = JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    if ((JSON_PARSER_ERROR_TERMINATION == r) && parser->error) {
+        r = parser->error;
+    }
 
+    if (JSON_PARSER_ERROR_OK != r) {
+        json_parser_reset(parser);
+    }
 
-static struct json_allocator_t
-json_parser_allocator = {
-    &json_parser_allocator_vtbl,
-    NULL
-};
+    json_parser_stats_end(parser, r);
+
+    return r;
+}
 
 
 int 
 json_parse_stream(struct json_parser_t *parser, struct json_stream_t *stream)
 {
-    json_parser_clear(parser);
+    struct json_parser_handler_t h;
+    unsigned flags = parser->flags;
+    int r;
 
-    if (!parser->a) {
-        parser->a = &json_parser_allocator;
+    /* the tree outlives the stream's buffer */
+    if (stream->vtbl->flags & JSON_STREAM_REUSES_BUFFER) {
+        parser->flags |= JSON_PARSER_COPY_STRINGS;
     }
 
-    struct json_parser_handler_t h;
-    h.vtbl = &json_parser_handler_vtbl;
-    h.ctx = parser;
+    json_parser_begin(parser, &h);
 
-    int r = json_read(stream, &h);
-    if (JSON_PARSER_ERROR_OK != r) {
-        json_value_free(parser->a, parser->root, 0);
+#if JSON_PARSER_STATS
+    const int counted = parser->stats && stream->vtbl->tell;
+    size_t begin = counted ? stream->vtbl->tell(stream->ctx) : 0;
+#endif
+
+    r = json_read(stream, &h);
+
+#if JSON_PARSER_STATS
+    if (counted) {
+        parser->stats->bytes += stream->vtbl->tell(stream->ctx) - begin;
     }
+#endif
 
-    return r;
-}
+    r = json_parser_end(parser, r);
 
+    parser->flags = flags;
 
-struct json_str_stream_ctx_t {
-    char *src;
-    char *dst;
-    char *head;
-    char *tail;
-};
+    return r;
+}
 
 
 static char
@@ -672,10 +1630,10 @@ json_str_stream_put_begin(void *ctx)
 }
 
 static size_t
-json_str_stream_put_end(void *ctx, char *begin)
+json_str_stream_put_end(void *ctx, char **begin)
 {
     struct json_str_stream_ctx_t *stream = ctx;
-    return stream->dst - begin;
+    return stream->dst - *begin;
 }
 
 
@@ -691,19 +1649,563 @@ json_parser_str_stream_vtbl = {
 };
 
 
+void
+json_str_stream_init(struct json_stream_t *stream, struct json_str_stream_ctx_t *ctx, const char *str, size_t len)
+{
+    ctx->src = ctx->head = (char *)str;
+    ctx->tail = ctx->src + len;
+    ctx->dst = NULL;
+
+    stream->vtbl = &json_parser_str_stream_vtbl;
+    stream->ctx = ctx;
+}
+
+
+static int
+json_parser_read_str(struct json_parser_t *parser, struct json_parser_handler_t *h, const char *str, size_t len)
+{
+    JSON_PARSER_COUNT(parser, bytes, len);
+
+    struct json_index_t local;
+    struct json_index_t *index = &parser->index;
+
+    if (!(parser->flags & JSON_PARSER_REUSE)) {
+        json_index_init(&local);
+        index = &local;
+    }
+
+    size_t mallocs = index->mallocs;
+    int r = json_read_str_with(str, len, h, index);
+
+    JSON_PARSER_COUNT(parser, heap_allocs, index->mallocs - mallocs);
+
+    if (index == &local) {
+        json_index_free(&local);
+    }
+
+    return r;
+}
+
+
 int
 json_parse_str(struct json_parser_t *parser, const char *str, size_t len)
 {
-    struct json_str_stream_ctx_t ctx;
+    struct json_parser_handler_t h;
+    json_parser_begin(parser, &h);
+
+    return json_parser_end(parser, json_parser_read_str(parser, &h, str, len));
+}
+
+
+int
+json_parse_file(struct json_parser_t *parser, const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    if (fstat(fd, &st) || (st.st_size < 0)) {
+        close(fd);
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    size_t size = (size_t)st.st_size;
+
+    if (!size) {
+        close(fd);
+        return json_parse_str(parser, "", 0);
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    /* prefault in one call rather than a fault per page; the whole file is read anyway */
+    flags |= MAP_POPULATE;
+#endif
+
+    void *map = mmap(NULL, size, PROT_READ, flags, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == map) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+#ifndef MAP_POPULATE
+    madvise(map, size, MADV_WILLNEED);
+#endif
+#ifdef MADV_HUGEPAGE
+    madvise(map, size, MADV_HUGEPAGE);
+#endif
+
+    /* parsed in place: the DOM points into the mapping, which lives until the next reset */
+    int r = json_parse_str(parser, map, size);
+
+    if (JSON_PARSER_ERROR_OK != r) {
+        munmap(map, size);
+        return r;
+    }
+
+    parser->map = map;
+    parser->map_size = size;
+
+    return r;
+}
+
+
+/*
+ * parallel parse of one big top-level array. a quote parity pass per
+ * chunk gives every chunk its starting string state, a second pass finds
+ * the commas at depth 1, and runs of elements are then parsed by separate
+ * parsers into their own arenas and stitched under one root. anything
+ * the passes cannot vouch for falls back to json_parse_str, so results
+ * (errors included) match the sequential parse.
+ */
+struct json_parallel_sep_t {
+    size_t pos;
+    long depth;
+};
+
+
+struct json_parallel_chunk_t {
+    const char *str;
+    size_t begin;
+    size_t end;
+
+    size_t quotes;
+    int in_string;
+
+    long depth;
+    struct json_parallel_sep_t *seps;
+    size_t seps_size;
+    size_t seps_capacity;
+    int error;
+};
+
+
+struct json_parallel_group_t {
+    const char *str;
+    const size_t *seps;
+    size_t first;
+    size_t last;
+    int is_tail;
+
+    struct json_parser_t parser;
+    int r;
+
+#if JSON_PARSER_STATS
+    struct json_parser_stats_t stats;
+#endif
+};
+
+
+static void
+json_parallel_run(void *(*fn)(void *), void *items, size_t item_size, unsigned n)
+{
+    pthread_t *threads = malloc(n * sizeof(pthread_t));
+    unsigned started = 0;
+
+    for (unsigned i = 1; threads && (i < n); ++i) {
+        if (pthread_create(&threads[started], NULL, fn, (char *)items + i * item_size)) {
+            break;
+        }
+
+        ++started;
+    }
+
+    /* whatever could not get a thread of its own runs here */
+    fn(items);
+
+    for (unsigned i = started + 1; i < n; ++i) {
+        fn((char *)items + i * item_size);
+    }
+
+    for (unsigned i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+}
+
+
+static void *
+json_parallel_count_quotes(void *arg)
+{
+    struct json_parallel_chunk_t *chunk = arg;
+    const char *str = chunk->str;
+    const char *p = str + chunk->begin;
+    const char *end = str + chunk->end;
+
+    for (; (p = memchr(p, '"', end - p)); ++p) {
+        const char *q = p;
+
+        while ((q > str) && ('\\' == q[-1])) {
+            --q;
+        }
+
+        chunk->quotes += !((p - q) & 1);
+    }
+
+    return NULL;
+}
+
+
+static void *
+json_parallel_find_seps(void *arg)
+{
+    struct json_parallel_chunk_t *chunk = arg;
+    const struct json_simd_vtbl_t *simd = json_simd();
+    const char *str = chunk->str;
+    const char *p = str + chunk->begin;
+    const char *end = str + chunk->end;
+    int in_string = chunk->in_string;
+
+    /* depth relative to the chunk start; commas are kept while at the lowest depth seen */
+    long depth = 0;
+    long floor = chunk->begin ? 0 : 1;
+
+    if (in_string) {
+        const char *q = p;
+
+        while ((q > str) && ('\\' == q[-1])) {
+            --q;
+        }
+
+        p += (p - q) & 1;
+    }
+
+    while (p < end) {
+        if (in_string) {
+            p = simd->scan_string(p, end);
+
+            if (p == end) {
+                break;
+            }
+
+            if ('\\' == *p) {
+                p += 2;
+                continue;
+            }
+
+            in_string = 0;
+            ++p;
+            continue;
+        }
+
+        switch (*p) {
+        case '"':
+            in_string = 1;
+            break;
+
+        case '[':
+        case '{':
+            ++depth;
+            break;
+
+        case ']':
+        case '}':
+            if (--depth < floor) {
+                floor = depth;
+            }
+            break;
+
+        case ',':
+            if (depth == floor) {
+                if (chunk->seps_size == chunk->seps_capacity) {
+                    size_t capacity = chunk->seps_capacity ? chunk->seps_capacity * 2 : 1024;
+
+                    struct json_parallel_sep_t *seps = realloc(chunk->seps, capacity * sizeof(struct json_parallel_sep_t));
+                    if (!seps) {
+                        chunk->error = 1;
+                        return NULL;
+                    }
+
+                    chunk->seps = seps;
+                    chunk->seps_capacity = capacity;
+                }
+
+                chunk->seps[chunk->seps_size].pos = p - str;
+                chunk->seps[chunk->seps_size].depth = depth;
+                ++chunk->seps_size;
+            }
+            break;
+        }
+
+        ++p;
+    }
+
+    chunk->depth = depth;
+
+    return NULL;
+}
+
+
+static void *
+json_parallel_parse_group(void *arg)
+{
+    struct json_parallel_group_t *g = arg;
+    struct json_parser_handler_t h;
+    struct json_str_reader_t r;
+    size_t count = 0;
+
+    r.tail = g->str + g->seps[g->last];
+    r.put = 0;
+    r.simd = json_simd();
+
+    json_parser_begin(&g->parser, &h);
+
+    int ret = JSON_PARSER_HANDLER((&h), on_start_array) ? JSON_PARSER_ERROR_TERMINATION : JSON_PARSER_ERROR_OK;
+
+    for (size_t i = g->first; !ret && (i < g->last); ++i) {
+        r.src = g->str + g->seps[i] + 1;
+        json_str_reader_skip_ws(&r);
+
+        if ((ret = json_read_value_str(&r, &h))) {
+            break;
+        }
+
+        json_str_reader_skip_ws(&r);
+
+        /* the last element of all is closed by the bracket, not a comma */
+        if (g->is_tail && (i + 1 == g->last)) {
+            ret = ((r.src < r.tail) && (']' == *r.src)) ? JSON_PARSER_ERROR_OK : JSON_PARSER_ERROR_UNSPECIFIC_SYNTAX_ERROR;
+        }
+        else if (r.src != g->str + g->seps[i + 1]) {
+            ret = JSON_PARSER_ERROR_UNSPECIFIC_SYNTAX_ERROR;
+        }
+
+        ++count;
+    }
+
+    if (!ret && JSON_PARSER_HANDLER((&h), on_end_array, count)) {
+        ret = JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    g->r = json_parser_end(&g->parser, ret);
+
+    return NULL;
+}
+
+
+/* what the groups' parsers counted, less what counts the parse as a whole */
+static void
+json_parallel_add_stats(struct json_parser_t *parser, struct json_parallel_group_t *groups, unsigned n)
+{
+#if JSON_PARSER_STATS
+    struct json_parser_stats_t *stats = parser->stats;
+
+    for (unsigned i = 0; stats && (i < n); ++i) {
+        const struct json_parser_stats_t *g = &groups[i].stats;
+
+        /* every group counts a root array of its own, the stitched one is counted once */
+        for (size_t t = 0; t <= JSON_VALUE_TYPE_UINT64; ++t) {
+            stats->values[t] += g->values[t] - ((JSON_VALUE_TYPE_ARRAY == t) && i);
+        }
+
+        stats->keys += g->keys;
+        stats->string_bytes += g->string_bytes;
+        stats->string_bytes_escaped += g->string_bytes_escaped;
+        stats->string_bytes_copied += g->string_bytes_copied;
+
+        /* its root value too; the elements' slices add up to the stitched array */
+        stats->allocs += g->allocs - (i ? 2 : 0);
+        stats->alloc_bytes += g->alloc_bytes - (i ? sizeof(struct json_value_t) : 0);
+        stats->heap_allocs += g->heap_allocs;
+
+        if (g->max_depth > stats->max_depth) {
+            stats->max_depth = g->max_depth;
+        }
+    }
+#endif
+}
+
+
+static int
+json_parallel_stitch(struct json_parser_t *parser, struct json_parallel_group_t *groups, unsigned n, size_t count)
+{
+    struct json_value_t *root = json_arena_alloc(&parser->arena, sizeof(struct json_value_t));
+    struct json_value_t *elts = json_arena_alloc(&parser->arena, count * sizeof(struct json_value_t));
+
+    if (!root || !elts) {
+        return -1;
+    }
+
+    size_t k = 0;
+
+    for (unsigned i = 0; i < n; ++i) {
+        struct json_value_t *group = groups[i].parser.root;
+
+        memcpy(elts + k, group->arr.elts, group->arr.size * sizeof(struct json_value_t));
+
+        for (size_t j = 0; j < group->arr.size; ++j) {
+            json_value_adopt(&elts[k + j]);
+        }
+
+        k += group->arr.size;
+
+        json_arena_merge(&parser->arena, &groups[i].parser.arena);
+    }
 
-    ctx.src = ctx.head = (char *)str;
-    ctx.tail = ctx.src + len;
-    ctx.dst = NULL;
+    root->type = JSON_VALUE_TYPE_ARRAY;
+    root->parent = NULL;
+    root->arr.elts = elts;
+    root->arr.size = root->arr.capacity = count;
+    json_value_adopt(root);
 
-    struct json_stream_t stream;
-    stream.vtbl = &json_parser_str_stream_vtbl;
-    stream.ctx = &ctx;
+    parser->root = root;
 
-    return json_parse_stream(parser, &stream);
+    return 0;
 }
 
+
+int
+json_parse_str_parallel(struct json_parser_t *parser, const char *str, size_t len, unsigned threads)
+{
+    if (!threads) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (n > 0) ? (unsigned)n : 1;
+    }
+
+    if (!parser->a) {
+        json_parser_init(parser, parser->max_depth, NULL);
+    }
+
+    /*
+     * the stitched tree moves between arenas, so it needs the parser's own;
+     * a key table serves one thread
+     */
+    if ((threads < 2) || (len < JSON_PARSER_PARALLEL_THRESHOLD) || (parser->a != &parser->arena_allocator)
+        || parser->keys) {
+        return json_parse_str(parser, str, len);
+    }
+
+    /* one parse to the counters and probes, however it ends up done */
+    json_parser_reset(parser);
+    json_parser_stats_begin(parser);
+
+    parser->error = JSON_PARSER_ERROR_OK;
+
+    struct json_parallel_chunk_t *chunks = calloc(threads, sizeof(struct json_parallel_chunk_t));
+    struct json_parallel_group_t *groups = calloc(threads, sizeof(struct json_parallel_group_t));
+    size_t *seps = NULL;
+    size_t count = 0;
+    unsigned n = 0;
+    unsigned i;
+    int ret = -1;
+
+    const char *open = json_simd()->skip_ws(str, str + len);
+
+    if (!chunks || !groups || (open == str + len) || ('[' != *open)) {
+        goto fallback;
+    }
+
+    for (i = 0; i < threads; ++i) {
+        chunks[i].str = str;
+        chunks[i].begin = len / threads * i;
+        chunks[i].end = (i + 1 == threads) ? len : len / threads * (i + 1);
+    }
+
+    json_parallel_run(&json_parallel_count_quotes, chunks, sizeof(struct json_parallel_chunk_t), threads);
+
+    for (i = 1; i < threads; ++i) {
+        chunks[i].in_string = chunks[i - 1].in_string ^ (int)(chunks[i - 1].quotes & 1);
+    }
+
+    json_parallel_run(&json_parallel_find_seps, chunks, sizeof(struct json_parallel_chunk_t), threads);
+
+    size_t total = 0;
+    for (i = 0; i < threads; ++i) {
+        if (chunks[i].error) {
+            goto fallback;
+        }
+
+        total += chunks[i].seps_size;
+    }
+
+    /* '[', the depth 1 commas, and the end of input */
+    if (!(seps = malloc((total + 2) * sizeof(size_t)))) {
+        goto fallback;
+    }
+
+    seps[count++] = open - str;
+
+    long depth = 0;
+    for (i = 0; i < threads; ++i) {
+        for (size_t j = 0; j < chunks[i].seps_size; ++j) {
+            if (depth + chunks[i].seps[j].depth == 1) {
+                seps[count++] = chunks[i].seps[j].pos;
+            }
+        }
+
+        depth += chunks[i].depth;
+    }
+
+    seps[count] = len;
+
+    if (count < threads) {
+        goto fallback;
+    }
+
+    /* contiguous runs of elements, roughly equal in bytes */
+    size_t first = 0;
+    for (i = 0; (i < threads) && (first < count); ++i) {
+        size_t last = first + 1;
+        size_t limit = len / threads * (i + 1);
+
+        while ((last < count) && ((seps[last] < limit) || (i + 1 == threads))) {
+            ++last;
+        }
+
+        groups[n].str = str;
+        groups[n].seps = seps;
+        groups[n].first = first;
+        groups[n].last = last;
+        groups[n].is_tail = (last == count);
+        json_parser_init(&groups[n].parser, parser->max_depth, NULL);
+        groups[n].parser.flags = parser->flags;
+#if JSON_PARSER_STATS
+        groups[n].parser.stats = parser->stats ? &groups[n].stats : NULL;
+#endif
+        ++n;
+
+        first = last;
+    }
+
+    json_parallel_run(&json_parallel_parse_group, groups, sizeof(struct json_parallel_group_t), n);
+
+    for (i = 0; i < n; ++i) {
+        if (groups[i].r) {
+            goto fallback;
+        }
+    }
+
+    if (!(ret = json_parallel_stitch(parser, groups, n, count))) {
+        JSON_PARSER_COUNT(parser, bytes, len);
+        json_parallel_add_stats(parser, groups, n);
+        json_parser_stats_end(parser, JSON_PARSER_ERROR_OK);
+    }
+
+fallback:
+    for (i = 0; i < n; ++i) {
+        json_parser_clear(&groups[i].parser);
+    }
+
+    for (i = 0; chunks && (i < threads); ++i) {
+        free(chunks[i].seps);
+    }
+
+    free(seps);
+    free(groups);
+    free(chunks);
+
+    if (ret) {
+        struct json_parser_handler_t h;
+        json_parser_restart(parser, &h);
+
+        return json_parser_end(parser, json_parser_read_str(parser, &h, str, len));
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
@@ -3,10 +3,11 @@
 
 #include <stdint.h>
 #include "json.h"
+#include "json_index.h"
 
 
 #define JSON_PARSER_IS_WS(c)     \
-    (' ' == (c)) || ('\n' == (c)) || ('\r' == (c)) || ('\t' == (c))
+    ((' ' == (c)) || ('\n' == (c)) || ('\r' == (c)) || ('\t' == (c)))
 
 
 #define JSON_PARSER_PEEK(stream)                                    \
@@ -40,6 +41,42 @@
     }
 
 
+/* strings are copied out of the stream: its buffer is reused as it refills */
+#define JSON_PARSER_COPY_STRINGS        0x1
+
+/* strings and keys that are not valid UTF-8 fail the parse with STRING_INVALID_ENCODING */
+#define JSON_PARSER_VALIDATE_UTF8       0x2
+
+/*
+ * the memory of a parse is kept for the next one instead of being freed:
+ * with the parser's own arena the tree is dropped by rewinding it, and
+ * documents of a size seen before parse without a heap allocation. the
+ * memory goes back with json_parser_clear.
+ */
+#define JSON_PARSER_REUSE               0x4
+
+
+#ifndef JSON_PARSER_INDEX_THRESHOLD
+#define JSON_PARSER_INDEX_THRESHOLD     (64 * 1024)
+#endif
+
+/* below this, splitting the work costs more than it saves */
+#ifndef JSON_PARSER_PARALLEL_THRESHOLD
+#define JSON_PARSER_PARALLEL_THRESHOLD  (1024 * 1024)
+#endif
+
+
+/*
+ * the counters behind parser->stats; build with JSON_PARSER_STATS 0 and
+ * they are left out, parser->stats and all. JSON_PARSER_USDT (needs
+ * sys/sdt.h) adds json:parse_start(parser) and json:parse_end(parser,
+ * error, stats) probes whether or not a parser has stats.
+ */
+#ifndef JSON_PARSER_STATS
+#define JSON_PARSER_STATS               1
+#endif
+
+
 #define JSON_PARSER_HANDLER(handler, h, ...)                        \
     (handler->vtbl->h)(handler->ctx, ##__VA_ARGS__)
 
@@ -69,7 +106,8 @@
     XX(NUMBER_MISS_FRACTION)                \
     XX(NUMBER_MISS_EXPONENT)                \
     XX(TERMINATION)                         \
-    XX(UNSPECIFIC_SYNTAX_ERROR)
+    XX(UNSPECIFIC_SYNTAX_ERROR)             \
+    XX(BIND_MISMATCH)
 
 
 enum json_parser_error_code_t {
@@ -102,45 +140,175 @@ struct json_parser_handler_t {
 };
 
 
-struct json_parser_t {
-    struct json_value_t *current;
+struct json_str_stream_ctx_t {
+    char *src;
+    char *dst;
+    char *head;
+    char *tail;
+};
+
+
+struct json_keys_t;
 
+
+/*
+ * what DOM parses cost, summed over every parse made with the struct
+ * set as parser->stats; zero it to start over. string bytes are decoded
+ * lengths of strings and keys: escaped ones still need json_strcpy to be
+ * read, copied ones were copied out of the input (the rest point into
+ * it). allocations are the ones made through the parser's allocator,
+ * heap ones those the parser made of malloc itself: arena chunks, its
+ * stacks and the structural index.
+ * nsec is wall time, cycles the cpu's counter where there is one.
+ */
+struct json_parser_stats_t {
+    uint64_t parses;
+    uint64_t errors;
+    uint64_t bytes;
+
+    uint64_t values[JSON_VALUE_TYPE_UINT64 + 1];
+    uint64_t keys;
+    uint64_t max_depth;
+
+    uint64_t string_bytes;
+    uint64_t string_bytes_escaped;
+    uint64_t string_bytes_copied;
+
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+    uint64_t heap_allocs;
+
+    uint64_t nsec;
+    uint64_t cycles;
+};
+
+
+#if JSON_PARSER_STATS
+#define JSON_PARSER_COUNT(parser, field, n)                         \
+    do {                                                            \
+        if ((parser)->stats) {                                      \
+            (parser)->stats->field += (n);                          \
+        }                                                           \
+    } while (0)
+#else
+#define JSON_PARSER_COUNT(parser, field, n)     do { } while (0)
+#endif
+
+
+struct json_parser_t {
     uint16_t depth;
     uint16_t max_depth;
+    unsigned flags;
+
+    /* why the DOM builder stopped the parse, when that is not out of memory */
+    int error;
 
     struct json_value_t *root;
     struct json_allocator_t *a;
+
+    struct json_arena_t arena;
+    struct json_allocator_t arena_allocator;
+
+    struct json_object_elt_t *stack;
+    size_t stack_size;
+    size_t stack_capacity;
+
+    size_t *frames;
+    size_t frames_capacity;
+
+    void *map;
+    size_t map_size;
+
+    /* kept between parses with JSON_PARSER_REUSE */
+    struct json_index_t index;
+
+    /* optional, see json_keys.h; the parser does not own it */
+    struct json_keys_t *keys;
+
+#if JSON_PARSER_STATS
+    /* optional, the parser does not own it either */
+    struct json_parser_stats_t *stats;
+    struct json_allocator_t stats_allocator;
+    uint64_t stats_nsec;
+    uint64_t stats_cycles;
+    size_t stats_mallocs;
+#endif
 };
 
 
 static inline void
 json_parser_init(struct json_parser_t *parser, uint16_t max_depth, struct json_allocator_t *a)
 {
-    parser->root = parser->current = NULL;
+    parser->root = NULL;
     parser->depth = 0;
     parser->max_depth = max_depth;
-    parser->a = a;
-}
+    parser->flags = 0;
+    parser->error = JSON_PARSER_ERROR_OK;
 
+    json_arena_init(&parser->arena, 0);
+    json_arena_allocator(&parser->arena_allocator, &parser->arena);
 
-static inline void
-json_parser_clear(struct json_parser_t *parser)
-{
-    if (parser->root) {
-        json_value_free(parser->a, parser->root, 0);
-    }
+    parser->a = a ? a : &parser->arena_allocator;
 
-    parser->root = parser->current = NULL;
-    parser->depth = 0;
+    parser->stack = NULL;
+    parser->stack_size = parser->stack_capacity = 0;
+
+    parser->frames = NULL;
+    parser->frames_capacity = 0;
+
+    parser->map = NULL;
+    parser->map_size = 0;
+
+    json_index_init(&parser->index);
+
+    parser->keys = NULL;
+
+#if JSON_PARSER_STATS
+    parser->stats = NULL;
+#endif
 }
 
 
+void json_parser_clear(struct json_parser_t *parser);
+
+
+/*
+ * starts a DOM parse driven from outside: resets the parser and points
+ * h at its DOM builder. json_parser_end takes the reader's result and
+ * settles parser->root, freeing the partial tree on error.
+ */
+void json_parser_begin(struct json_parser_t *parser, struct json_parser_handler_t *h);
+
+int json_parser_end(struct json_parser_t *parser, int r);
+
+
 int json_read(struct json_stream_t *stream, struct json_parser_handler_t *handler);
 
+int json_read_str(const char *str, size_t len, struct json_parser_handler_t *handler);
+
+/*
+ * JSON_PARSER_ERROR_STRING_INVALID_ENCODING unless str is valid UTF-8:
+ * what JSON_PARSER_VALIDATE_UTF8 checks, for handlers of their own.
+ * strings as the reader hands them out can be checked as they are.
+ */
+int json_utf8_validate(const char *str, size_t len);
+
+void json_str_stream_init(struct json_stream_t *stream, struct json_str_stream_ctx_t *ctx, const char *str, size_t len);
+
 int json_parse_stream(struct json_parser_t *parser, struct json_stream_t *stream);
 
 int json_parse_str(struct json_parser_t *parser, const char *str, size_t len);
 
+int json_parse_file(struct json_parser_t *parser, const char *path);
+
+/*
+ * json_parse_str on up to threads threads (0: one per online cpu) for a
+ * document whose root is an array; the tree and error codes are the ones
+ * json_parse_str gives. needs the parser's default (arena) allocator and
+ * no key table, it runs json_parse_str otherwise.
+ */
+int json_parse_str_parallel(struct json_parser_t *parser, const char *str, size_t len, unsigned threads);
+
 
 #endif //_JSON_PARSER_H_INCLUDED
 
@@ -0,0 +1,199 @@
+#include "json_path.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static size_t
+json_path_add_node(struct json_path_t *path)
+{
+    if (path->size == path->capacity) {
+        size_t capacity = path->capacity ? path->capacity * 2 : 16;
+
+        struct json_path_node_t *nodes = realloc(path->nodes, capacity * sizeof(struct json_path_node_t));
+        if (!nodes) {
+            return JSON_PATH_NONE;
+        }
+
+        path->nodes = nodes;
+        path->capacity = capacity;
+    }
+
+    struct json_path_node_t *node = &path->nodes[path->size];
+
+    node->key = NULL;
+    node->len = 0;
+    node->index = JSON_PATH_NONE;
+    node->target = JSON_PATH_NONE;
+    node->child = node->sibling = 0;
+
+    return path->size++;
+}
+
+
+static size_t
+json_path_index(const char *key, size_t len)
+{
+    size_t index = 0;
+
+    if (!len || ((len > 1) && ('0' == key[0]))) {
+        return JSON_PATH_NONE;
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+        if ((key[i] < '0') || (key[i] > '9') || (index > (JSON_PATH_NONE - 10) / 10)) {
+            return JSON_PATH_NONE;
+        }
+
+        index = index * 10 + (key[i] - '0');
+    }
+
+    return index;
+}
+
+
+/* the child of parent named by the token key (unescaped), added if there is none */
+static size_t
+json_path_child(struct json_path_t *path, size_t parent, const char *key, size_t len)
+{
+    for (size_t i = path->nodes[parent].child; i; i = path->nodes[i].sibling) {
+        if ((path->nodes[i].len == len) && !memcmp(path->nodes[i].key, key, len)) {
+            return i;
+        }
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy) {
+        return 0;
+    }
+
+    size_t n = json_path_add_node(path);
+    if (JSON_PATH_NONE == n) {
+        free(copy);
+        return 0;
+    }
+
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+
+    struct json_path_node_t *node = &path->nodes[n];
+
+    node->key = copy;
+    node->len = len;
+    node->index = json_path_index(copy, len);
+    node->sibling = path->nodes[parent].child;
+
+    path->nodes[parent].child = n;
+
+    return n;
+}
+
+
+/* splits p into tokens, unescaping the pointer ones, and marks the node of the last one */
+static int
+json_path_add(struct json_path_t *path, const char *p, size_t target)
+{
+    int pointer = ('/' == *p);
+    char sep = pointer ? '/' : '.';
+    size_t node = 0;
+    char *token = NULL;
+
+    if (*p) {
+        token = malloc(strlen(p) + 1);
+        if (!token) {
+            return -1;
+        }
+
+        if (pointer) {
+            ++p;
+        }
+
+        while (1) {
+            size_t len = 0;
+
+            for (; *p && (sep != *p); ++p) {
+                char c = *p;
+
+                if (pointer && ('~' == c)) {
+                    c = *++p;
+
+                    if ('0' == c) {
+                        c = '~';
+                    }
+                    else if ('1' == c) {
+                        c = '/';
+                    }
+                    else {
+                        goto fail;
+                    }
+                }
+
+                token[len++] = c;
+            }
+
+            if (path->nodes[node].target != JSON_PATH_NONE) {
+                goto fail;
+            }
+
+            if (!(node = json_path_child(path, node, token, len))) {
+                goto fail;
+            }
+
+            if (!*p++) {
+                break;
+            }
+        }
+
+        free(token);
+    }
+
+    if ((path->nodes[node].target != JSON_PATH_NONE) || path->nodes[node].child) {
+        return -1;
+    }
+
+    path->nodes[node].target = target;
+
+    return 0;
+
+fail:
+    free(token);
+
+    return -1;
+}
+
+
+int
+json_path_compile(struct json_path_t *path, const char **paths, size_t count)
+{
+    path->nodes = NULL;
+    path->size = path->capacity = 0;
+    path->count = count;
+
+    /* the root */
+    if (JSON_PATH_NONE == json_path_add_node(path)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (json_path_add(path, paths[i], i)) {
+            json_path_free(path);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+void
+json_path_free(struct json_path_t *path)
+{
+    for (size_t i = 0; i < path->size; ++i) {
+        free(path->nodes[i].key);
+    }
+
+    free(path->nodes);
+
+    path->nodes = NULL;
+    path->size = path->capacity = 0;
+    path->count = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef _JSON_PATH_H_INCLUDED
+#define _JSON_PATH_H_INCLUDED
+
+#include "json_parser.h"
+
+
+#define JSON_PATH_NONE              ((size_t)-1)
+
+
+/*
+ * one reference token of the compiled paths. nodes[0] is the document
+ * root; the children of a node are chained through sibling. key is the
+ * unescaped token, index the array element it names (JSON_PATH_NONE when
+ * it is not an array index) and target the path that ends here.
+ */
+struct json_path_node_t {
+    char *key;
+    size_t len;
+    size_t index;
+    size_t target;
+
+    size_t child;
+    size_t sibling;
+};
+
+
+struct json_path_t {
+    struct json_path_node_t *nodes;
+    size_t size;
+    size_t capacity;
+
+    size_t count;
+};
+
+
+/*
+ * on_match gets the number of the path whose value comes next; the value
+ * itself (a whole subtree for a container) goes to handler as json_read
+ * would report it. a non-zero return stops the read.
+ */
+struct json_path_handler_t {
+    int(*on_match)(void *ctx, size_t path);
+    void *ctx;
+
+    struct json_parser_handler_t *handler;
+};
+
+
+/*
+ * paths are JSON Pointers (RFC 6901: "/header/tenant", "" for the whole
+ * document) or, when they do not start with '/', dotted paths
+ * ("header.tenant"). a token of digits also names that array element.
+ * fails on a malformed pointer, and on a path that equals or lies under
+ * another one: a value is delivered once.
+ */
+int json_path_compile(struct json_path_t *path, const char **paths, size_t count);
+
+void json_path_free(struct json_path_t *path);
+
+
+/*
+ * reads only as much of the document as the paths need: members and
+ * elements off every path are skipped without callbacks (and without
+ * being validated), and the read stops as soon as every path has had its
+ * value. a path that is not in the document gets no on_match.
+ */
+int json_read_path(struct json_stream_t *stream, const struct json_path_t *path,
+                   struct json_path_handler_t *handler);
+
+int json_read_path_str(const char *str, size_t len, const struct json_path_t *path,
+                       struct json_path_handler_t *handler);
+
+
+#endif //_JSON_PATH_H_INCLUDED
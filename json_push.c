@@ -0,0 +1,725 @@
+#include "json_push.h"
+#include "json_utf8.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+enum json_push_state_t {
+    JSON_PUSH_VALUE,
+    JSON_PUSH_ARRAY_FIRST,
+    JSON_PUSH_OBJECT_FIRST,
+    JSON_PUSH_KEY,
+    JSON_PUSH_COLON,
+    JSON_PUSH_NEXT,
+    JSON_PUSH_DONE,
+
+    JSON_PUSH_STRING,
+    JSON_PUSH_STRING_ESCAPE,
+    JSON_PUSH_STRING_HEX,
+    JSON_PUSH_STRING_LOW,
+    JSON_PUSH_STRING_LOW_U,
+    JSON_PUSH_LITERAL,
+    JSON_PUSH_NUMBER_SIGN,
+    JSON_PUSH_NUMBER_ZERO,
+    JSON_PUSH_NUMBER_INT,
+    JSON_PUSH_NUMBER_DOT,
+    JSON_PUSH_NUMBER_FRACTION,
+    JSON_PUSH_NUMBER_E,
+    JSON_PUSH_NUMBER_E_SIGN,
+    JSON_PUSH_NUMBER_EXPONENT
+};
+
+
+#define JSON_PUSH_IN_TOKEN(state)       ((state) >= JSON_PUSH_STRING)
+
+/* the states where the token's text is kept for the handler (literals need none) */
+#define JSON_PUSH_KEEPS_TEXT(state)     (JSON_PUSH_IN_TOKEN(state) && (JSON_PUSH_LITERAL != (state)))
+
+
+/*
+ * next byte of input into c; a chunk running out suspends the parse,
+ * the end of input reads as (char)-1 like a drained stream.
+ */
+#define JSON_PUSH_NEXT_CHAR(s, end, eof)                            \
+    if ((s) < (end)) {                                              \
+        c = *(s);                                                   \
+    }                                                               \
+    else if (eof) {                                                 \
+        c = (char)-1;                                               \
+    }                                                               \
+    else {                                                          \
+        goto suspend;                                               \
+    }
+
+
+static int
+json_push_keep(struct json_push_parser_t *p, const char *data, size_t len)
+{
+    if (!len) {
+        return 0;
+    }
+
+    if (p->len + len > p->capacity) {
+        size_t capacity = p->capacity ? p->capacity : 64;
+
+        while (capacity < p->len + len) {
+            capacity *= 2;
+        }
+
+        char *buf = realloc(p->buf, capacity);
+        if (!buf) {
+            return -1;
+        }
+
+        p->buf = buf;
+        p->capacity = capacity;
+    }
+
+    memcpy(p->buf + p->len, data, len);
+    p->len += len;
+
+    return 0;
+}
+
+
+static int
+json_push_scope(struct json_push_parser_t *p, int is_object)
+{
+    if (p->depth == p->scopes_capacity) {
+        size_t capacity = p->scopes_capacity ? p->scopes_capacity * 2 : 16;
+
+        struct json_push_scope_t *scopes = realloc(p->scopes, capacity * sizeof(struct json_push_scope_t));
+        if (!scopes) {
+            return -1;
+        }
+
+        p->scopes = scopes;
+        p->scopes_capacity = capacity;
+    }
+
+    p->scopes[p->depth].is_object = is_object;
+    p->scopes[p->depth].count = 0;
+    ++p->depth;
+
+    return 0;
+}
+
+
+static inline void
+json_push_value_done(struct json_push_parser_t *p)
+{
+    if (p->depth) {
+        ++p->scopes[p->depth - 1].count;
+        p->state = JSON_PUSH_NEXT;
+    }
+    else {
+        p->state = JSON_PUSH_DONE;
+    }
+}
+
+
+static int
+json_push_end_scope(struct json_push_parser_t *p)
+{
+    struct json_push_scope_t *top = &p->scopes[--p->depth];
+    struct json_parser_handler_t *handler = &p->handler;
+
+    if (top->is_object
+        ? JSON_PARSER_HANDLER(handler, on_end_object, top->count)
+        : JSON_PARSER_HANDLER(handler, on_end_array, top->count)) {
+
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    json_push_value_done(p);
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+json_push_start_value(struct json_push_parser_t *p, const char **s)
+{
+    struct json_parser_handler_t *handler = &p->handler;
+
+    switch (**s) {
+    case '"':
+        ++*s;
+        p->is_key = 0;
+        p->put = 0;
+        p->state = JSON_PUSH_STRING;
+        break;
+
+    case '{':
+        ++*s;
+
+        if (JSON_PARSER_HANDLER(handler, on_start_object) || json_push_scope(p, 1)) {
+            return JSON_PARSER_ERROR_TERMINATION;
+        }
+
+        p->state = JSON_PUSH_OBJECT_FIRST;
+        break;
+
+    case '[':
+        ++*s;
+
+        if (JSON_PARSER_HANDLER(handler, on_start_array) || json_push_scope(p, 0)) {
+            return JSON_PARSER_ERROR_TERMINATION;
+        }
+
+        p->state = JSON_PUSH_ARRAY_FIRST;
+        break;
+
+    case 't':
+        p->literal = "true";
+        p->put = 0;
+        p->state = JSON_PUSH_LITERAL;
+        break;
+
+    case 'f':
+        p->literal = "false";
+        p->put = 0;
+        p->state = JSON_PUSH_LITERAL;
+        break;
+
+    case 'n':
+        p->literal = "null";
+        p->put = 0;
+        p->state = JSON_PUSH_LITERAL;
+        break;
+
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        memset(&p->n, 0, sizeof p->n);
+        p->e = 0;
+        p->e_negative = 0;
+        p->is_int = 1;
+
+        if ('-' == **s) {
+            ++*s;
+            p->n.negative = 1;
+        }
+
+        p->state = JSON_PUSH_NUMBER_SIGN;
+        break;
+
+    default:
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+json_push_run(struct json_push_parser_t *p, const char *s, const char *end, int eof)
+{
+    struct json_parser_handler_t *handler = &p->handler;
+    const char *tok = s;
+    const char *text;
+    size_t len;
+    char c;
+    int r;
+
+    while (1) {
+        switch (p->state) {
+
+        case JSON_PUSH_VALUE:
+        case JSON_PUSH_ARRAY_FIRST:
+        case JSON_PUSH_OBJECT_FIRST:
+        case JSON_PUSH_KEY:
+        case JSON_PUSH_COLON:
+        case JSON_PUSH_NEXT:
+        case JSON_PUSH_DONE:
+            if ((s < end) && JSON_PARSER_IS_WS(*s)) {
+                s = p->simd->skip_ws(s + 1, end);
+            }
+
+            if (s == end) {
+                if (!eof) {
+                    return JSON_PARSER_ERROR_OK;
+                }
+
+                switch (p->state) {
+                case JSON_PUSH_DONE:
+                    return JSON_PARSER_ERROR_OK;
+                case JSON_PUSH_OBJECT_FIRST:
+                case JSON_PUSH_KEY:
+                    return JSON_PARSER_ERROR_OBJECT_MISS_NAME;
+                case JSON_PUSH_COLON:
+                    return JSON_PARSER_ERROR_OBJECT_MISS_COLON;
+                case JSON_PUSH_NEXT:
+                    return p->scopes[p->depth - 1].is_object
+                        ? JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET
+                        : JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+                default:
+                    return JSON_PARSER_ERROR_VALUE_INVALID;
+                }
+            }
+
+            c = *s;
+            tok = s;
+            p->len = 0;
+
+            switch (p->state) {
+            case JSON_PUSH_ARRAY_FIRST:
+                if (']' == c) {
+                    ++s;
+                    r = json_push_end_scope(p);
+                    break;
+                }
+                /* fall through */
+
+            case JSON_PUSH_VALUE:
+                r = json_push_start_value(p, &s);
+
+                if (JSON_PUSH_STRING == p->state) {
+                    tok = s;
+                }
+                break;
+
+            case JSON_PUSH_OBJECT_FIRST:
+                if ('}' == c) {
+                    ++s;
+                    r = json_push_end_scope(p);
+                    break;
+                }
+                /* fall through */
+
+            case JSON_PUSH_KEY:
+                if ('"' != c) {
+                    return JSON_PARSER_ERROR_OBJECT_MISS_NAME;
+                }
+
+                tok = ++s;
+                p->is_key = 1;
+                p->put = 0;
+                p->state = JSON_PUSH_STRING;
+                r = JSON_PARSER_ERROR_OK;
+                break;
+
+            case JSON_PUSH_COLON:
+                if (':' != c) {
+                    return JSON_PARSER_ERROR_OBJECT_MISS_COLON;
+                }
+
+                ++s;
+                p->state = JSON_PUSH_VALUE;
+                r = JSON_PARSER_ERROR_OK;
+                break;
+
+            case JSON_PUSH_NEXT:
+                if (',' == c) {
+                    ++s;
+                    p->state = p->scopes[p->depth - 1].is_object ? JSON_PUSH_KEY : JSON_PUSH_VALUE;
+                    r = JSON_PARSER_ERROR_OK;
+                }
+                else if (p->scopes[p->depth - 1].is_object) {
+                    if ('}' != c) {
+                        return JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET;
+                    }
+
+                    ++s;
+                    r = json_push_end_scope(p);
+                }
+                else {
+                    if (']' != c) {
+                        return JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+                    }
+
+                    ++s;
+                    r = json_push_end_scope(p);
+                }
+                break;
+
+            default:
+                return JSON_PARSER_ERROR_DOCUMENT_ROOT_NOT_SINGULAR;
+            }
+
+            if (r) {
+                return r;
+            }
+            break;
+
+        case JSON_PUSH_STRING:
+            {
+                const char *q = p->simd->scan_string(s, end);
+
+                p->put += q - s;
+                s = q;
+            }
+
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if ('\\' == c) {
+                ++s;
+                p->state = JSON_PUSH_STRING_ESCAPE;
+                break;
+            }
+
+            if ('"' != c) {
+                return JSON_PARSER_ERROR_STRING_MISS_QUOTATION_MARK;
+            }
+
+            if (p->len && json_push_keep(p, tok, s - tok)) {
+                return JSON_PARSER_ERROR_TERMINATION;
+            }
+
+            text = p->len ? p->buf : tok;
+            ++s;
+
+            if ((p->is_key ? handler->vtbl->on_key : handler->vtbl->on_string)(handler->ctx, text, p->put)) {
+                return JSON_PARSER_ERROR_TERMINATION;
+            }
+
+            if (p->is_key) {
+                p->state = JSON_PUSH_COLON;
+            }
+            else {
+                json_push_value_done(p);
+            }
+            break;
+
+        case JSON_PUSH_STRING_ESCAPE:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            switch (c) {
+            case '\\':
+            case '/':
+            case '"':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u':
+                ++s;
+                p->unicode = 0;
+                p->hex = 0;
+                p->state = JSON_PUSH_STRING_HEX;
+                continue;
+            default:
+                return JSON_PARSER_ERROR_VALUE_INVALID;
+            }
+
+            ++s;
+            ++p->put;
+            p->state = JSON_PUSH_STRING;
+            break;
+
+        case JSON_PUSH_STRING_HEX:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            {
+                int d = json_hex_digit((unsigned char)c);
+
+                if (d < 0) {
+                    return JSON_PARSER_ERROR_STRING_UNICODE_ESCAPE_INVALID_HEX;
+                }
+
+                ++s;
+                p->unicode = (p->unicode << 4) | (uint32_t)d;
+            }
+
+            if (++p->hex < 4) {
+                break;
+            }
+
+            /* the first half of a pair waits in high for the second */
+            if (p->high) {
+                if (!JSON_UTF8_IS_LOW(p->unicode)) {
+                    return JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID;
+                }
+
+                p->put += json_utf8_size(JSON_UTF8_PAIR(p->high, p->unicode));
+                p->high = 0;
+            }
+            else if (JSON_UTF8_IS_HIGH(p->unicode)) {
+                p->high = p->unicode;
+                p->state = JSON_PUSH_STRING_LOW;
+                break;
+            }
+            else if (JSON_UTF8_IS_LOW(p->unicode)) {
+                return JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID;
+            }
+            else {
+                p->put += json_utf8_size(p->unicode);
+            }
+
+            p->state = JSON_PUSH_STRING;
+            break;
+
+        case JSON_PUSH_STRING_LOW:
+        case JSON_PUSH_STRING_LOW_U:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if (c != ((JSON_PUSH_STRING_LOW == p->state) ? '\\' : 'u')) {
+                return JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID;
+            }
+
+            ++s;
+
+            if (JSON_PUSH_STRING_LOW == p->state) {
+                p->state = JSON_PUSH_STRING_LOW_U;
+            }
+            else {
+                p->unicode = 0;
+                p->hex = 0;
+                p->state = JSON_PUSH_STRING_HEX;
+            }
+            break;
+
+        case JSON_PUSH_LITERAL:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if (c != p->literal[p->put]) {
+                return JSON_PARSER_ERROR_VALUE_INVALID;
+            }
+
+            ++s;
+
+            if (p->literal[++p->put]) {
+                break;
+            }
+
+            if (('n' == p->literal[0])
+                ? JSON_PARSER_HANDLER(handler, on_null)
+                : JSON_PARSER_HANDLER(handler, on_bool, 't' == p->literal[0])) {
+
+                return JSON_PARSER_ERROR_TERMINATION;
+            }
+
+            json_push_value_done(p);
+            break;
+
+        case JSON_PUSH_NUMBER_SIGN:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if ('0' == c) {
+                ++s;
+                p->state = JSON_PUSH_NUMBER_ZERO;
+            }
+            else if ((c >= '1') && (c <= '9')) {
+                p->state = JSON_PUSH_NUMBER_INT;
+            }
+            else {
+                return JSON_PARSER_ERROR_VALUE_INVALID;
+            }
+            break;
+
+        case JSON_PUSH_NUMBER_INT:
+        case JSON_PUSH_NUMBER_FRACTION:
+            s = json_number_scan_digits(&p->n, s, end, JSON_PUSH_NUMBER_FRACTION == p->state);
+            /* fall through */
+
+        case JSON_PUSH_NUMBER_ZERO:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if (('.' == c) && (JSON_PUSH_NUMBER_FRACTION != p->state)) {
+                ++s;
+                p->is_int = 0;
+                p->state = JSON_PUSH_NUMBER_DOT;
+                break;
+            }
+
+            if (('e' == c) || ('E' == c)) {
+                ++s;
+                p->is_int = 0;
+                p->state = JSON_PUSH_NUMBER_E;
+                break;
+            }
+
+            goto number;
+
+        case JSON_PUSH_NUMBER_DOT:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if ((c < '0') || (c > '9')) {
+                return JSON_PARSER_ERROR_NUMBER_MISS_FRACTION;
+            }
+
+            p->state = JSON_PUSH_NUMBER_FRACTION;
+            break;
+
+        case JSON_PUSH_NUMBER_E:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if (('-' == c) || ('+' == c)) {
+                ++s;
+                p->e_negative = ('-' == c);
+                p->state = JSON_PUSH_NUMBER_E_SIGN;
+                break;
+            }
+            /* fall through */
+
+        case JSON_PUSH_NUMBER_E_SIGN:
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            if ((c < '0') || (c > '9')) {
+                return JSON_PARSER_ERROR_NUMBER_MISS_EXPONENT;
+            }
+
+            p->state = JSON_PUSH_NUMBER_EXPONENT;
+            break;
+
+        case JSON_PUSH_NUMBER_EXPONENT:
+            while ((s < end) && (*s >= '0') && (*s <= '9')) {
+                /* anything past this is 0 or inf whatever the significand */
+                if (p->e < 0x10000000) {
+                    p->e = p->e * 10 + (*s - '0');
+                }
+
+                ++s;
+            }
+
+            JSON_PUSH_NEXT_CHAR(s, end, eof);
+
+            p->n.exponent += p->e_negative ? -p->e : p->e;
+
+number:
+            if (p->len && json_push_keep(p, tok, s - tok)) {
+                return JSON_PARSER_ERROR_TERMINATION;
+            }
+
+            text = p->len ? p->buf : tok;
+            len = p->len ? p->len : (size_t)(s - tok);
+
+            if ((r = json_number_emit(handler, &p->n, p->is_int, text, len))) {
+                return r;
+            }
+
+            json_push_value_done(p);
+            break;
+        }
+    }
+
+suspend:
+    if (JSON_PUSH_KEEPS_TEXT(p->state) && json_push_keep(p, tok, end - tok)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+json_push_fail(struct json_push_parser_t *p, int r)
+{
+    if (p->parser) {
+        p->parser->flags = p->parser_flags;
+        r = json_parser_end(p->parser, r);
+        p->parser = NULL;
+    }
+
+    p->error = r;
+
+    return r;
+}
+
+
+void
+json_push_parser_init(struct json_push_parser_t *p, struct json_parser_handler_t *handler)
+{
+    p->handler = *handler;
+    p->simd = json_simd();
+
+    p->state = JSON_PUSH_VALUE;
+    p->error = JSON_PARSER_ERROR_OK;
+
+    p->scopes = NULL;
+    p->depth = p->scopes_capacity = 0;
+
+    p->buf = NULL;
+    p->len = p->capacity = 0;
+
+    p->is_key = 0;
+    p->put = 0;
+    p->literal = NULL;
+    p->high = 0;
+
+    p->parser = NULL;
+    p->parser_flags = 0;
+}
+
+
+void
+json_push_parser_dom(struct json_push_parser_t *p, struct json_parser_t *parser)
+{
+    struct json_parser_handler_t h;
+    json_parser_begin(parser, &h);
+
+    json_push_parser_init(p, &h);
+
+    p->parser = parser;
+    p->parser_flags = parser->flags;
+    parser->flags |= JSON_PARSER_COPY_STRINGS;
+}
+
+
+int
+json_feed(struct json_push_parser_t *p, const char *chunk, size_t len)
+{
+    if (p->error) {
+        return p->error;
+    }
+
+    if (p->parser) {
+        JSON_PARSER_COUNT(p->parser, bytes, len);
+    }
+
+    int r = json_push_run(p, chunk, chunk + len, 0);
+
+    return r ? json_push_fail(p, r) : r;
+}
+
+
+int
+json_finish(struct json_push_parser_t *p)
+{
+    if (p->error) {
+        return p->error;
+    }
+
+    int r = json_push_run(p, "", "", 1);
+
+    if (r) {
+        return json_push_fail(p, r);
+    }
+
+    if (p->parser) {
+        p->parser->flags = p->parser_flags;
+        r = json_parser_end(p->parser, r);
+        p->parser = NULL;
+    }
+
+    p->error = r;
+
+    return r;
+}
+
+
+void
+json_push_parser_free(struct json_push_parser_t *p)
+{
+    if (p->parser) {
+        json_push_fail(p, JSON_PARSER_ERROR_TERMINATION);
+    }
+
+    free(p->scopes);
+    p->scopes = NULL;
+    p->depth = p->scopes_capacity = 0;
+
+    free(p->buf);
+    p->buf = NULL;
+    p->len = p->capacity = 0;
+}
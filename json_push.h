@@ -0,0 +1,67 @@
+#ifndef _JSON_PUSH_H_INCLUDED
+#define _JSON_PUSH_H_INCLUDED
+
+#include "json_parser.h"
+#include "json_number.h"
+#include "json_simd.h"
+
+
+struct json_push_scope_t {
+    int is_object;
+    size_t count;
+};
+
+
+/*
+ * incremental reader: input arrives in chunks through json_feed and the
+ * handler sees the same events json_read would produce. the parse stack
+ * is explicit, so a chunk may end anywhere, including inside a string,
+ * number or literal. bytes are looked at once; a token split across
+ * chunks is carried over in buf (in source form) and handed out from
+ * there, any other token points into the chunk it came from.
+ */
+struct json_push_parser_t {
+    struct json_parser_handler_t handler;
+    const struct json_simd_vtbl_t *simd;
+
+    int state;
+    int error;
+
+    struct json_push_scope_t *scopes;
+    size_t depth;
+    size_t scopes_capacity;
+
+    char *buf;
+    size_t len;
+    size_t capacity;
+
+    /* the token in progress */
+    int is_key;
+    size_t put;
+    const char *literal;
+    uint32_t unicode;
+    uint32_t high;
+    int hex;
+    struct json_number_t n;
+    int64_t e;
+    int e_negative;
+    int is_int;
+
+    struct json_parser_t *parser;
+    unsigned parser_flags;
+};
+
+
+void json_push_parser_init(struct json_push_parser_t *p, struct json_parser_handler_t *handler);
+
+/* builds a DOM in parser; strings are copied, the chunks need not outlive json_feed */
+void json_push_parser_dom(struct json_push_parser_t *p, struct json_parser_t *parser);
+
+int json_feed(struct json_push_parser_t *p, const char *chunk, size_t len);
+
+int json_finish(struct json_push_parser_t *p);
+
+void json_push_parser_free(struct json_push_parser_t *p);
+
+
+#endif //_JSON_PUSH_H_INCLUDED
@@ -0,0 +1,741 @@
+/*
+ * reader template, included by json_parser.c once per input kind.
+ * the includer defines JSON_READER_T, JSON_READER_FN and the
+ * JSON_READER_PEEK/TAKE/PUT_BEGIN/PUT/PUT_END primitives, and may
+ * override JSON_READER_SKIP_WS, JSON_READER_PUT_SPAN (bulk copy of
+ * a run of unescaped string bytes), JSON_READER_DIGITS (a run of
+ * number digits) and JSON_READER_SKIP_CONTAINER (moves past the
+ * container at the stream unread) with faster versions. PUT_END gets
+ * the address of the span start, which a refilling stream may move.
+ */
+
+#define JSON_READER_CONSUME(stream, expect)                         \
+    ((expect == JSON_READER_PEEK(stream))                           \
+        ? (JSON_READER_TAKE(stream), 0) : -1)
+
+
+#ifndef JSON_READER_SKIP_WS
+#define JSON_READER_SKIP_WS(stream)                                 \
+    while (JSON_PARSER_IS_WS(JSON_READER_PEEK(stream))) {           \
+        JSON_READER_TAKE(stream);                                   \
+    }
+#endif
+
+
+#ifndef JSON_READER_DIGITS
+#define JSON_READER_DIGITS(stream, n, fraction)                     \
+    while (c = JSON_READER_PEEK(stream), (c >= '0') && (c <= '9')) { \
+        JSON_READER_PUT(stream, JSON_READER_TAKE(stream));          \
+        json_number_push_digit(n, c, fraction);                     \
+    }
+#endif
+
+
+#ifndef JSON_READER_PUT_SPAN
+#define JSON_READER_PUT_SPAN(stream)    ((void)0)
+#endif
+
+
+#ifndef JSON_READER_SKIP_CONTAINER
+#define JSON_READER_SKIP_CONTAINER(stream)                          \
+    JSON_READER_FN(json_skip_container)(stream)
+#endif
+
+
+static inline int
+JSON_READER_FN(json_read_hex4)(JSON_READER_T *stream, uint32_t *cp)
+{
+    uint32_t u = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        int d = json_hex_digit((unsigned char)JSON_READER_TAKE(stream));
+
+        if (d < 0) {
+            return JSON_PARSER_ERROR_STRING_UNICODE_ESCAPE_INVALID_HEX;
+        }
+
+        u = (u << 4) | (uint32_t)d;
+    }
+
+    *cp = u;
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+/* the code point of the \u escape past the 'u', a surrogate pair joined */
+static int
+JSON_READER_FN(json_read_unicode)(JSON_READER_T *stream, uint32_t *cp)
+{
+    uint32_t low;
+    int r;
+
+    if ((r = JSON_READER_FN(json_read_hex4)(stream, cp))) {
+        return r;
+    }
+
+    if (JSON_UTF8_IS_LOW(*cp)) {
+        return JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID;
+    }
+
+    if (!JSON_UTF8_IS_HIGH(*cp)) {
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    if (JSON_READER_CONSUME(stream, '\\') || JSON_READER_CONSUME(stream, 'u')) {
+        return JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID;
+    }
+
+    if ((r = JSON_READER_FN(json_read_hex4)(stream, &low))) {
+        return r;
+    }
+
+    if (!JSON_UTF8_IS_LOW(low)) {
+        return JSON_PARSER_ERROR_STRING_UNICODE_SURROGATE_INVALID;
+    }
+
+    *cp = JSON_UTF8_PAIR(*cp, low);
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+/* head and length of the string at the stream, which moves past it */
+static inline int
+JSON_READER_FN(json_scan_string)(JSON_READER_T *stream, char **begin, size_t *len)
+{
+    if (JSON_READER_CONSUME(stream, '"')) {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    char *head = JSON_READER_PUT_BEGIN(stream);
+
+    char c;
+    while (JSON_READER_PUT_SPAN(stream), c = JSON_READER_TAKE(stream), '"' != c) {
+
+        if ((char)-1 == c) {
+            return JSON_PARSER_ERROR_STRING_MISS_QUOTATION_MARK;
+        }
+
+        if ('\\' == c) {
+            c = JSON_READER_TAKE(stream);
+            switch (c) {
+            case '\\':
+            case '/':
+            case '"':
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'u': {
+                uint32_t cp;
+                char utf8[JSON_UTF8_MAX];
+                int r = JSON_READER_FN(json_read_unicode)(stream, &cp);
+
+                if (r) {
+                    return r;
+                }
+
+                for (size_t i = 0, n = json_utf8_encode(cp, utf8); i < n; ++i) {
+                    JSON_READER_PUT(stream, utf8[i]);
+                }
+
+                continue;
+            }
+            default:
+                return JSON_PARSER_ERROR_VALUE_INVALID;
+            }
+        }
+
+        JSON_READER_PUT(stream, c);
+    }
+
+    *len = JSON_READER_PUT_END(stream, &head);
+    *begin = head;
+    assert(*len <= 0xFFFFFFFF);
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+JSON_READER_FN(json_read_string_opt)(JSON_READER_T *stream, struct json_parser_handler_t *handler, int is_key)
+{
+    char *head;
+    size_t length;
+    int r;
+
+    if ((r = JSON_READER_FN(json_scan_string)(stream, &head, &length))) {
+        return r;
+    }
+
+    if ((is_key ? handler->vtbl->on_key : handler->vtbl->on_string)(handler->ctx, head, length)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+JSON_READER_FN(json_read_string)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    return JSON_READER_FN(json_read_string_opt)(stream, handler, 0);
+}
+
+
+static inline int
+JSON_READER_FN(json_read_null)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    if (JSON_READER_CONSUME(stream, 'n')
+        || JSON_READER_CONSUME(stream, 'u')
+        || JSON_READER_CONSUME(stream, 'l')
+        || JSON_READER_CONSUME(stream, 'l')) {
+
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    if (JSON_PARSER_HANDLER(handler, on_null)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static inline int
+JSON_READER_FN(json_read_true)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    if (JSON_READER_CONSUME(stream, 't')
+        || JSON_READER_CONSUME(stream, 'r')
+        || JSON_READER_CONSUME(stream, 'u')
+        || JSON_READER_CONSUME(stream, 'e')) {
+
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    if (JSON_PARSER_HANDLER(handler, on_bool, 1)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static inline int
+JSON_READER_FN(json_read_false)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    if (JSON_READER_CONSUME(stream, 'f')
+        || JSON_READER_CONSUME(stream, 'a')
+        || JSON_READER_CONSUME(stream, 'l')
+        || JSON_READER_CONSUME(stream, 's')
+        || JSON_READER_CONSUME(stream, 'e')) {
+
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    if (JSON_PARSER_HANDLER(handler, on_bool, 0)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static int
+JSON_READER_FN(json_read_number)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    struct json_number_t n = { 0, 0, 0, 0 };
+    int64_t e = 0;
+    int is_int = 1;
+    char c;
+
+    char *head = JSON_READER_PUT_BEGIN(stream);
+
+    if ('-' == JSON_READER_PEEK(stream)) {
+        JSON_READER_PUT(stream, JSON_READER_TAKE(stream));
+        n.negative = 1;
+    }
+
+    c = JSON_READER_PEEK(stream);
+    if ('0' == c) {
+        JSON_READER_PUT(stream, JSON_READER_TAKE(stream));
+    }
+    else if ((c >= '1') && (c <= '9')) {
+        JSON_READER_DIGITS(stream, &n, 0);
+    }
+    else {
+        return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+
+    if ('.' == JSON_READER_PEEK(stream)) {
+        JSON_READER_PUT(stream, JSON_READER_TAKE(stream));
+        is_int = 0;
+
+        c = JSON_READER_PEEK(stream);
+        if ((c < '0') || (c > '9')) {
+            return JSON_PARSER_ERROR_NUMBER_MISS_FRACTION;
+        }
+
+        JSON_READER_DIGITS(stream, &n, 1);
+    }
+
+    c = JSON_READER_PEEK(stream);
+    if (('e' == c) || ('E' == c)) {
+        int e_negative = 0;
+
+        JSON_READER_PUT(stream, JSON_READER_TAKE(stream));
+        is_int = 0;
+
+        c = JSON_READER_PEEK(stream);
+        if (('-' == c) || ('+' == c)) {
+            JSON_READER_PUT(stream, JSON_READER_TAKE(stream));
+            e_negative = ('-' == c);
+            c = JSON_READER_PEEK(stream);
+        }
+
+        if ((c < '0') || (c > '9')) {
+            return JSON_PARSER_ERROR_NUMBER_MISS_EXPONENT;
+        }
+
+        do {
+            JSON_READER_PUT(stream, JSON_READER_TAKE(stream));
+
+            /* anything past this is 0 or inf whatever the significand */
+            if (e < 0x10000000) {
+                e = e * 10 + (c - '0');
+            }
+        } while (c = JSON_READER_PEEK(stream), (c >= '0') && (c <= '9'));
+
+        n.exponent += e_negative ? -e : e;
+    }
+
+    size_t len = JSON_READER_PUT_END(stream, &head);
+
+    return json_number_emit(handler, &n, is_int, head, len);
+}
+
+
+/* any value but an object or an array */
+static inline int
+JSON_READER_FN(json_read_scalar)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    switch (JSON_READER_PEEK(stream)) {
+
+        case '"':
+            return JSON_READER_FN(json_read_string)(stream, handler);
+
+        case 't':
+            return JSON_READER_FN(json_read_true)(stream, handler);
+
+        case 'f':
+            return JSON_READER_FN(json_read_false)(stream, handler);
+
+        case 'n':
+            return JSON_READER_FN(json_read_null)(stream, handler);
+
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return JSON_READER_FN(json_read_number)(stream, handler);
+
+        default:
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+    }
+}
+
+
+/*
+ * the value at the stream. containers are tracked on a stack of scopes,
+ * local up to JSON_READ_SCOPES deep and on the heap past that, so nesting
+ * costs no C stack; how deep a document may go is the handler's call.
+ */
+static int
+JSON_READER_FN(json_read_value)(JSON_READER_T *stream, struct json_parser_handler_t *handler)
+{
+    struct json_read_scope_t local[JSON_READ_SCOPES];
+    struct json_read_scope_t *stack = local;
+    struct json_read_scope_t *top = NULL;
+    size_t capacity = JSON_READ_SCOPES;
+    int ret;
+
+value:
+    switch (JSON_READER_PEEK(stream)) {
+    case '{':
+        JSON_READER_TAKE(stream);
+
+        if (JSON_PARSER_HANDLER(handler, on_start_object)
+            || json_read_push(&stack, local, &top, &capacity, 1)) {
+
+            ret = JSON_PARSER_ERROR_TERMINATION;
+            goto done;
+        }
+
+        JSON_READER_SKIP_WS(stream);
+
+        if (!JSON_READER_CONSUME(stream, '}')) {
+            goto end_scope;
+        }
+
+        goto key;
+
+    case '[':
+        JSON_READER_TAKE(stream);
+
+        if (JSON_PARSER_HANDLER(handler, on_start_array)
+            || json_read_push(&stack, local, &top, &capacity, 0)) {
+
+            ret = JSON_PARSER_ERROR_TERMINATION;
+            goto done;
+        }
+
+        JSON_READER_SKIP_WS(stream);
+
+        if (!JSON_READER_CONSUME(stream, ']')) {
+            goto end_scope;
+        }
+
+        goto value;
+
+    default:
+        if ((ret = JSON_READER_FN(json_read_scalar)(stream, handler))) {
+            goto done;
+        }
+
+        goto next;
+    }
+
+key:
+    if ('"' != JSON_READER_PEEK(stream)) {
+        ret = JSON_PARSER_ERROR_OBJECT_MISS_NAME;
+        goto done;
+    }
+
+    if ((ret = JSON_READER_FN(json_read_string_opt)(stream, handler, 1))) {
+        goto done;
+    }
+
+    JSON_READER_SKIP_WS(stream);
+
+    if (JSON_READER_CONSUME(stream, ':')) {
+        ret = JSON_PARSER_ERROR_OBJECT_MISS_COLON;
+        goto done;
+    }
+
+    JSON_READER_SKIP_WS(stream);
+    goto value;
+
+end_scope:
+    if (top->is_object
+        ? JSON_PARSER_HANDLER(handler, on_end_object, top->count)
+        : JSON_PARSER_HANDLER(handler, on_end_array, top->count)) {
+
+        ret = JSON_PARSER_ERROR_TERMINATION;
+        goto done;
+    }
+
+    top = (top == stack) ? NULL : top - 1;
+
+next:
+    if (!top) {
+        ret = JSON_PARSER_ERROR_OK;
+        goto done;
+    }
+
+    ++top->count;
+
+    JSON_READER_SKIP_WS(stream);
+
+    switch (JSON_READER_PEEK(stream)) {
+    case ',':
+        JSON_READER_TAKE(stream);
+        JSON_READER_SKIP_WS(stream);
+
+        if (top->is_object) {
+            goto key;
+        }
+
+        goto value;
+
+    case '}':
+        if (top->is_object) {
+            JSON_READER_TAKE(stream);
+            goto end_scope;
+        }
+        break;
+
+    case ']':
+        if (!top->is_object) {
+            JSON_READER_TAKE(stream);
+            goto end_scope;
+        }
+        break;
+    }
+
+    ret = top->is_object
+        ? JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET
+        : JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+
+done:
+    if (stack != local) {
+        free(stack);
+    }
+
+    return ret;
+}
+
+
+static int
+JSON_READER_FN(json_skip_string)(JSON_READER_T *stream)
+{
+    char c;
+
+    JSON_READER_TAKE(stream);
+
+    while (JSON_READER_PUT_SPAN(stream), c = JSON_READER_TAKE(stream), '"' != c) {
+        if ((char)-1 == c) {
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+        }
+
+        if ('\\' == c) {
+            JSON_READER_TAKE(stream);
+        }
+    }
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+static inline int
+JSON_READER_FN(json_skip_container)(JSON_READER_T *stream)
+{
+    size_t depth = 0;
+    int r;
+
+    do {
+        switch (JSON_READER_PEEK(stream)) {
+        case '"':
+            if ((r = JSON_READER_FN(json_skip_string)(stream))) {
+                return r;
+            }
+            continue;
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            --depth;
+            break;
+        case (char)-1:
+            return JSON_PARSER_ERROR_VALUE_INVALID;
+        }
+
+        JSON_READER_TAKE(stream);
+    } while (depth);
+
+    return JSON_PARSER_ERROR_OK;
+}
+
+
+/* moves past the value at the stream; brackets are counted, not matched */
+static int
+JSON_READER_FN(json_skip_value)(JSON_READER_T *stream)
+{
+    size_t n = 0;
+    char c;
+
+    switch (JSON_READER_PEEK(stream)) {
+    case '"':
+        return JSON_READER_FN(json_skip_string)(stream);
+    case '{':
+    case '[':
+        return JSON_READER_SKIP_CONTAINER(stream);
+    }
+
+    while (c = JSON_READER_PEEK(stream), (char)-1 != c && !JSON_PARSER_IS_WS(c)
+           && (',' != c) && (']' != c) && ('}' != c) && (':' != c)) {
+        JSON_READER_TAKE(stream);
+        ++n;
+    }
+
+    return n ? JSON_PARSER_ERROR_OK : JSON_PARSER_ERROR_VALUE_INVALID;
+}
+
+
+static int
+JSON_READER_FN(json_read_path_value)(JSON_READER_T *stream, struct json_path_read_t *s, size_t node);
+
+
+static int
+JSON_READER_FN(json_read_path_object)(JSON_READER_T *stream, struct json_path_read_t *s, size_t node)
+{
+    const struct json_path_node_t *nodes = s->path->nodes;
+    int r;
+
+    JSON_READER_TAKE(stream);
+    JSON_READER_SKIP_WS(stream);
+
+    if (!JSON_READER_CONSUME(stream, '}')) {
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    while (1) {
+        struct json_string_t key;
+        size_t child;
+
+        if ('"' != JSON_READER_PEEK(stream)) {
+            return JSON_PARSER_ERROR_OBJECT_MISS_NAME;
+        }
+
+        if ((r = JSON_READER_FN(json_scan_string)(stream, &key.data, &key.len))) {
+            return r;
+        }
+
+        for (child = nodes[node].child; child; child = nodes[child].sibling) {
+            if (json_string_equal(&key, nodes[child].key, nodes[child].len)) {
+                break;
+            }
+        }
+
+        JSON_READER_SKIP_WS(stream);
+
+        if (JSON_READER_CONSUME(stream, ':')) {
+            return JSON_PARSER_ERROR_OBJECT_MISS_COLON;
+        }
+
+        JSON_READER_SKIP_WS(stream);
+
+        r = child
+            ? JSON_READER_FN(json_read_path_value)(stream, s, child)
+            : JSON_READER_FN(json_skip_value)(stream);
+
+        if (r || !s->remaining) {
+            return r;
+        }
+
+        JSON_READER_SKIP_WS(stream);
+
+        switch (JSON_READER_PEEK(stream)) {
+        case ',':
+            JSON_READER_TAKE(stream);
+            JSON_READER_SKIP_WS(stream);
+            break;
+        case '}':
+            JSON_READER_TAKE(stream);
+            return JSON_PARSER_ERROR_OK;
+        default:
+            return JSON_PARSER_ERROR_OBJECT_MISS_COMMA_OR_CURLY_BRACKET;
+        }
+    }
+}
+
+
+static int
+JSON_READER_FN(json_read_path_array)(JSON_READER_T *stream, struct json_path_read_t *s, size_t node)
+{
+    const struct json_path_node_t *nodes = s->path->nodes;
+    size_t i = 0;
+    int r;
+
+    JSON_READER_TAKE(stream);
+    JSON_READER_SKIP_WS(stream);
+
+    if (!JSON_READER_CONSUME(stream, ']')) {
+        return JSON_PARSER_ERROR_OK;
+    }
+
+    while (1) {
+        size_t child;
+
+        for (child = nodes[node].child; child; child = nodes[child].sibling) {
+            if (nodes[child].index == i) {
+                break;
+            }
+        }
+
+        r = child
+            ? JSON_READER_FN(json_read_path_value)(stream, s, child)
+            : JSON_READER_FN(json_skip_value)(stream);
+
+        if (r || !s->remaining) {
+            return r;
+        }
+
+        ++i;
+
+        JSON_READER_SKIP_WS(stream);
+
+        if (!JSON_READER_CONSUME(stream, ']')) {
+            return JSON_PARSER_ERROR_OK;
+        }
+
+        if (JSON_READER_CONSUME(stream, ',')) {
+            return JSON_PARSER_ERROR_ARRAY_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+
+        JSON_READER_SKIP_WS(stream);
+    }
+}
+
+
+/* the value at node of the path tree: delivered if a path ends there, walked if one goes through */
+static int
+JSON_READER_FN(json_read_path_value)(JSON_READER_T *stream, struct json_path_read_t *s, size_t node)
+{
+    const struct json_path_node_t *n = &s->path->nodes[node];
+
+    if (JSON_PATH_NONE != n->target) {
+        uint64_t bit = (uint64_t)1 << (n->target % 64);
+
+        /* a repeated key */
+        if (s->done[n->target / 64] & bit) {
+            return JSON_READER_FN(json_skip_value)(stream);
+        }
+
+        s->done[n->target / 64] |= bit;
+        --s->remaining;
+
+        if (s->handler->on_match(s->handler->ctx, n->target)) {
+            return JSON_PARSER_ERROR_TERMINATION;
+        }
+
+        return JSON_READER_FN(json_read_value)(stream, s->handler->handler);
+    }
+
+    switch (JSON_READER_PEEK(stream)) {
+    case '{':
+        return JSON_READER_FN(json_read_path_object)(stream, s, node);
+    case '[':
+        return JSON_READER_FN(json_read_path_array)(stream, s, node);
+    default:
+        return JSON_READER_FN(json_skip_value)(stream);
+    }
+}
+
+
+#undef JSON_READER_CONSUME
+#undef JSON_READER_SKIP_WS
+#undef JSON_READER_PUT_SPAN
+#undef JSON_READER_DIGITS
+#undef JSON_READER_SKIP_CONTAINER
@@ -0,0 +1,778 @@
+#include "json_simd.h"
+#include "json_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+
+static const char *
+json_skip_ws_scalar(const char *p, const char *end)
+{
+    while ((p < end) && JSON_PARSER_IS_WS(*p)) {
+        ++p;
+    }
+
+    return p;
+}
+
+
+static const char *
+json_scan_string_scalar(const char *p, const char *end)
+{
+    while ((p < end) && ('"' != *p) && ('\\' != *p)) {
+        ++p;
+    }
+
+    return p;
+}
+
+
+static const char *
+json_scan_escape_scalar(const char *p, const char *end)
+{
+    while ((p < end) && ('"' != *p) && ('\\' != *p) && ((unsigned char)*p >= 0x20)) {
+        ++p;
+    }
+
+    return p;
+}
+
+
+/* past the multibyte sequence at p, NULL if it is not valid UTF-8 */
+static inline const char *
+json_utf8_sequence(const char *p, const char *end)
+{
+    const unsigned char *s = (const unsigned char *)p;
+    uint32_t cp;
+    size_t n;
+
+    if ((s[0] >= 0xC2) && (s[0] <= 0xDF)) {
+        cp = s[0] & 0x1F;
+        n = 1;
+    }
+    else if ((s[0] >= 0xE0) && (s[0] <= 0xEF)) {
+        cp = s[0] & 0x0F;
+        n = 2;
+    }
+    else if ((s[0] >= 0xF0) && (s[0] <= 0xF4)) {
+        cp = s[0] & 0x07;
+        n = 3;
+    }
+    else {
+        return NULL;
+    }
+
+    if ((size_t)(end - p) <= n) {
+        return NULL;
+    }
+
+    for (size_t i = 1; i <= n; ++i) {
+        if ((s[i] & 0xC0) != 0x80) {
+            return NULL;
+        }
+
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+
+    /* overlong forms, surrogates and past U+10FFFF */
+    if (((2 == n) && ((cp < 0x800) || ((cp >= 0xD800) && (cp <= 0xDFFF))))
+        || ((3 == n) && ((cp < 0x10000) || (cp > 0x10FFFF)))) {
+        return NULL;
+    }
+
+    return p + n + 1;
+}
+
+
+static int
+json_validate_utf8_scalar(const char *p, const char *end)
+{
+    uint64_t w;
+
+    while (p < end) {
+        if (end - p >= 8) {
+            memcpy(&w, p, 8);
+
+            if (!(w & 0x8080808080808080ULL)) {
+                p += 8;
+                continue;
+            }
+        }
+
+        if (!(*p & 0x80)) {
+            ++p;
+        }
+        else if (!(p = json_utf8_sequence(p, end))) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+#define JSON_SIMD_EVEN_BITS     0x5555555555555555ULL
+
+
+static inline uint64_t
+json_simd_prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+
+    return x;
+}
+
+
+static inline uint64_t
+json_simd_quotes(struct json_simd_index_state_t *s, uint64_t quote, uint64_t backslash)
+{
+    backslash &= ~s->prev_escaped;
+
+    uint64_t follows_escape = (backslash << 1) | s->prev_escaped;
+    uint64_t odd_sequence_starts = backslash & ~JSON_SIMD_EVEN_BITS & ~follows_escape;
+
+    uint64_t sequences_starting_on_even_bits;
+    s->prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash, &sequences_starting_on_even_bits);
+
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    uint64_t escaped = (JSON_SIMD_EVEN_BITS ^ invert_mask) & follows_escape;
+
+    return quote & ~escaped;
+}
+
+
+static inline uint64_t
+json_simd_structurals(struct json_simd_index_state_t *s, uint64_t quote, uint64_t in_string,
+                      uint64_t op, uint64_t ws)
+{
+    s->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+    uint64_t scalar = ~(op | ws);
+    uint64_t nonquote_scalar = scalar & ~quote;
+    uint64_t follows_nonquote_scalar = (nonquote_scalar << 1) | s->prev_scalar;
+    s->prev_scalar = nonquote_scalar >> 63;
+
+    uint64_t string_tail = in_string ^ quote;
+
+    return (op | (scalar & ~follows_nonquote_scalar)) & ~string_tail;
+}
+
+
+static inline uint32_t *
+json_simd_flatten(uint32_t *out, uint32_t base, uint64_t bits)
+{
+    while (bits) {
+        *out++ = base + (uint32_t)__builtin_ctzll(bits);
+        bits &= bits - 1;
+    }
+
+    return out;
+}
+
+
+static size_t
+json_index_scalar(const char *p, size_t len, uint32_t base, uint32_t *out,
+                  struct json_simd_index_state_t *s)
+{
+    uint32_t *begin = out;
+
+    for (size_t i = 0; i < len; i += JSON_SIMD_BLOCK_SIZE) {
+        uint64_t quote = 0, backslash = 0, op = 0, ws = 0;
+
+        for (int j = 0; j < JSON_SIMD_BLOCK_SIZE; ++j) {
+            uint64_t bit = (uint64_t)1 << j;
+
+            switch (p[i + j]) {
+            case '"':
+                quote |= bit;
+                break;
+            case '\\':
+                backslash |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                op |= bit;
+                break;
+            case ' ':
+            case '\n':
+            case '\r':
+            case '\t':
+                ws |= bit;
+                break;
+            }
+        }
+
+        quote = json_simd_quotes(s, quote, backslash);
+        uint64_t in_string = json_simd_prefix_xor(quote) ^ s->prev_in_string;
+
+        out = json_simd_flatten(out, base + (uint32_t)i, json_simd_structurals(s, quote, in_string, op, ws));
+    }
+
+    return out - begin;
+}
+
+
+static const struct json_simd_vtbl_t
+json_simd_scalar_vtbl = {
+    "scalar",
+    &json_skip_ws_scalar,
+    &json_scan_string_scalar,
+    &json_index_scalar,
+    &json_scan_escape_scalar,
+    &json_validate_utf8_scalar
+};
+
+
+#ifdef JSON_SIMD_X86
+
+__attribute__((target("sse2")))
+static const char *
+json_skip_ws_sse2(const char *p, const char *end)
+{
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, lf)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    return json_skip_ws_scalar(p, end);
+}
+
+
+__attribute__((target("sse2")))
+static const char *
+json_scan_string_sse2(const char *p, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    return json_scan_string_scalar(p, end);
+}
+
+
+__attribute__((target("sse2")))
+static const char *
+json_scan_escape_sse2(const char *p, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    return json_scan_escape_scalar(p, end);
+}
+
+
+__attribute__((target("avx2")))
+static const char *
+json_skip_ws_avx2(const char *p, const char *end)
+{
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, lf)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab)));
+
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(ws);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    /* the SSE tail would pay for the dirty upper halves otherwise */
+    _mm256_zeroupper();
+
+    return json_skip_ws_sse2(p, end);
+}
+
+
+__attribute__((target("avx2")))
+static const char *
+json_scan_string_avx2(const char *p, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    _mm256_zeroupper();
+
+    return json_scan_string_sse2(p, end);
+}
+
+
+__attribute__((target("avx2")))
+static const char *
+json_scan_escape_avx2(const char *p, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                      _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    _mm256_zeroupper();
+
+    return json_scan_escape_sse2(p, end);
+}
+
+
+__attribute__((target("sse2")))
+static size_t
+json_index_sse2(const char *p, size_t len, uint32_t base, uint32_t *out,
+                struct json_simd_index_state_t *s)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lcurly = _mm_set1_epi8('{');
+    const __m128i rcurly = _mm_set1_epi8('}');
+    const __m128i lsquare = _mm_set1_epi8('[');
+    const __m128i rsquare = _mm_set1_epi8(']');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    uint32_t *begin = out;
+
+    for (size_t i = 0; i < len; i += JSON_SIMD_BLOCK_SIZE) {
+        uint64_t q = 0, bs = 0, op = 0, ws = 0;
+
+        for (int j = 0; j < JSON_SIMD_BLOCK_SIZE; j += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i + j));
+
+            __m128i o = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lcurly), _mm_cmpeq_epi8(v, rcurly)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, lsquare), _mm_cmpeq_epi8(v, rsquare)));
+            o = _mm_or_si128(o, _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+
+            __m128i w = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, lf)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+
+            q |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << j;
+            bs |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << j;
+            op |= (uint64_t)(unsigned)_mm_movemask_epi8(o) << j;
+            ws |= (uint64_t)(unsigned)_mm_movemask_epi8(w) << j;
+        }
+
+        q = json_simd_quotes(s, q, bs);
+        uint64_t in_string = json_simd_prefix_xor(q) ^ s->prev_in_string;
+
+        out = json_simd_flatten(out, base + (uint32_t)i, json_simd_structurals(s, q, in_string, op, ws));
+    }
+
+    return out - begin;
+}
+
+
+__attribute__((target("avx2,pclmul")))
+static size_t
+json_index_avx2(const char *p, size_t len, uint32_t base, uint32_t *out,
+                struct json_simd_index_state_t *s)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i upper = _mm256_set1_epi8(0x20);
+    const __m256i op_table = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+    const __m256i ws_table = _mm256_setr_epi8(
+        ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100,
+        ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100);
+
+    uint32_t *begin = out;
+
+    for (size_t i = 0; i < len; i += JSON_SIMD_BLOCK_SIZE) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+
+        uint64_t q = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)) << 32;
+
+        uint64_t bs = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, backslash))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, backslash)) << 32;
+
+        uint64_t op = (uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_shuffle_epi8(op_table, lo), _mm256_or_si256(lo, upper)))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_shuffle_epi8(op_table, hi), _mm256_or_si256(hi, upper))) << 32;
+
+        uint64_t ws = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(ws_table, lo), lo))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(ws_table, hi), hi)) << 32;
+
+        q = json_simd_quotes(s, q, bs);
+
+        uint64_t in_string = (uint64_t)_mm_cvtsi128_si64(
+            _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)q), _mm_set1_epi8((char)0xFF), 0));
+        in_string ^= s->prev_in_string;
+
+        out = json_simd_flatten(out, base + (uint32_t)i, json_simd_structurals(s, q, in_string, op, ws));
+    }
+
+    return out - begin;
+}
+
+
+__attribute__((target("sse2")))
+static int
+json_validate_utf8_sse2(const char *p, const char *end)
+{
+    while (end - p >= 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+
+        if (!mask) {
+            p += 16;
+            continue;
+        }
+
+        /* one sequence at a time from the first non-ASCII byte */
+        if (!(p = json_utf8_sequence(p + __builtin_ctz(mask), end))) {
+            return -1;
+        }
+    }
+
+    return json_validate_utf8_scalar(p, end);
+}
+
+
+/*
+ * the lookup algorithm of Keiser and Lemire: the high and low nibbles of
+ * each byte's predecessor and the high nibble of the byte itself index
+ * three tables of the errors a pair can show; and-ing them leaves the
+ * ones that occur. third and fourth bytes of a sequence are told apart
+ * by looking two and three bytes back.
+ */
+#define JSON_UTF8_TOO_SHORT     0x01
+#define JSON_UTF8_TOO_LONG      0x02
+#define JSON_UTF8_OVERLONG_3    0x04
+#define JSON_UTF8_TOO_LARGE     0x08
+#define JSON_UTF8_SURROGATE     0x10
+#define JSON_UTF8_OVERLONG_2    0x20
+#define JSON_UTF8_TOO_LARGE_1000 0x40
+#define JSON_UTF8_OVERLONG_4    0x40
+#define JSON_UTF8_TWO_CONTS     0x80
+#define JSON_UTF8_CARRY         (JSON_UTF8_TOO_SHORT | JSON_UTF8_TOO_LONG | JSON_UTF8_TWO_CONTS)
+
+#define JSON_UTF8_TABLE(...)    _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+
+__attribute__((target("avx2")))
+static inline __m256i
+json_utf8_prev(__m256i v, __m256i prev, int n)
+{
+    __m256i joined = _mm256_permute2x128_si256(prev, v, 0x21);
+
+    switch (n) {
+    case 1:
+        return _mm256_alignr_epi8(v, joined, 15);
+    case 2:
+        return _mm256_alignr_epi8(v, joined, 14);
+    default:
+        return _mm256_alignr_epi8(v, joined, 13);
+    }
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i
+json_utf8_errors(__m256i v, __m256i prev)
+{
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+
+    const __m256i byte_1_high = JSON_UTF8_TABLE(
+        JSON_UTF8_TOO_LONG, JSON_UTF8_TOO_LONG, JSON_UTF8_TOO_LONG, JSON_UTF8_TOO_LONG,
+        JSON_UTF8_TOO_LONG, JSON_UTF8_TOO_LONG, JSON_UTF8_TOO_LONG, JSON_UTF8_TOO_LONG,
+        (char)JSON_UTF8_TWO_CONTS, (char)JSON_UTF8_TWO_CONTS, (char)JSON_UTF8_TWO_CONTS, (char)JSON_UTF8_TWO_CONTS,
+        JSON_UTF8_TOO_SHORT | JSON_UTF8_OVERLONG_2,
+        JSON_UTF8_TOO_SHORT,
+        JSON_UTF8_TOO_SHORT | JSON_UTF8_OVERLONG_3 | JSON_UTF8_SURROGATE,
+        JSON_UTF8_TOO_SHORT | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000 | JSON_UTF8_OVERLONG_4);
+
+    const __m256i byte_1_low = JSON_UTF8_TABLE(
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_OVERLONG_3 | JSON_UTF8_OVERLONG_2 | JSON_UTF8_OVERLONG_4),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_OVERLONG_2),
+        (char)JSON_UTF8_CARRY,
+        (char)JSON_UTF8_CARRY,
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000 | JSON_UTF8_SURROGATE),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000),
+        (char)(JSON_UTF8_CARRY | JSON_UTF8_TOO_LARGE | JSON_UTF8_TOO_LARGE_1000));
+
+    const __m256i byte_2_high = JSON_UTF8_TABLE(
+        JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT,
+        JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT,
+        (char)(JSON_UTF8_TOO_LONG | JSON_UTF8_OVERLONG_2 | JSON_UTF8_TWO_CONTS | JSON_UTF8_OVERLONG_3
+               | JSON_UTF8_TOO_LARGE_1000 | JSON_UTF8_OVERLONG_4),
+        (char)(JSON_UTF8_TOO_LONG | JSON_UTF8_OVERLONG_2 | JSON_UTF8_TWO_CONTS | JSON_UTF8_OVERLONG_3
+               | JSON_UTF8_TOO_LARGE),
+        (char)(JSON_UTF8_TOO_LONG | JSON_UTF8_OVERLONG_2 | JSON_UTF8_TWO_CONTS | JSON_UTF8_SURROGATE
+               | JSON_UTF8_TOO_LARGE),
+        (char)(JSON_UTF8_TOO_LONG | JSON_UTF8_OVERLONG_2 | JSON_UTF8_TWO_CONTS | JSON_UTF8_SURROGATE
+               | JSON_UTF8_TOO_LARGE),
+        JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT, JSON_UTF8_TOO_SHORT);
+
+    __m256i prev1 = json_utf8_prev(v, prev, 1);
+
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+            _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, low_nibble))),
+        _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble)));
+
+    /* only bytes 111_____ two back and 1111____ three back end up >= 0x80 */
+    __m256i third = _mm256_subs_epu8(json_utf8_prev(v, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(json_utf8_prev(v, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+
+    __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+
+    return _mm256_xor_si256(must_be_continuation, special);
+}
+
+
+/* nonzero where a sequence starting in the last three bytes of v would run past it */
+__attribute__((target("avx2")))
+static inline __m256i
+json_utf8_incomplete(__m256i v)
+{
+    const __m256i max = _mm256_setr_epi8(
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+
+    return _mm256_subs_epu8(v, max);
+}
+
+
+__attribute__((target("avx2")))
+static int
+json_validate_utf8_avx2(const char *p, const char *end)
+{
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    char block[32];
+
+    /* short strings, most of them, are not worth the padded block */
+    if (end - p < 32) {
+        return json_validate_utf8_sse2(p, end);
+    }
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+
+        if (!_mm256_movemask_epi8(v)) {
+            error = _mm256_or_si256(error, incomplete);
+        }
+        else {
+            error = _mm256_or_si256(error, json_utf8_errors(v, prev));
+            incomplete = json_utf8_incomplete(v);
+        }
+
+        prev = v;
+    }
+
+    /* the last block ended between sequences: the rest stands alone */
+    if (_mm256_testz_si256(incomplete, incomplete)) {
+        if (!_mm256_testz_si256(error, error)) {
+            return -1;
+        }
+
+        _mm256_zeroupper();
+
+        return json_validate_utf8_sse2(p, end);
+    }
+
+    /* the rest zero padded: a sequence cut short by the end meets a NUL */
+    memset(block, 0, sizeof block);
+    memcpy(block, p, end - p);
+
+    __m256i v = _mm256_loadu_si256((const __m256i *)block);
+
+    error = _mm256_or_si256(error, json_utf8_errors(v, prev));
+    error = _mm256_or_si256(error, json_utf8_incomplete(v));
+
+    return _mm256_testz_si256(error, error) ? 0 : -1;
+}
+
+
+static const struct json_simd_vtbl_t
+json_simd_sse2_vtbl = {
+    "sse2",
+    &json_skip_ws_sse2,
+    &json_scan_string_sse2,
+    &json_index_sse2,
+    &json_scan_escape_sse2,
+    &json_validate_utf8_sse2
+};
+
+
+static const struct json_simd_vtbl_t
+json_simd_avx2_vtbl = {
+    "avx2",
+    &json_skip_ws_avx2,
+    &json_scan_string_avx2,
+    &json_index_avx2,
+    &json_scan_escape_avx2,
+    &json_validate_utf8_avx2
+};
+
+#endif
+
+
+static const struct json_simd_vtbl_t *
+json_simd_resolve(void)
+{
+    const char *env = getenv("JSON_SIMD");
+
+    if (env && !strcmp(env, "scalar")) {
+        return &json_simd_scalar_vtbl;
+    }
+
+#ifdef JSON_SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul")
+        && !(env && !strcmp(env, "sse2"))) {
+
+        return &json_simd_avx2_vtbl;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return &json_simd_sse2_vtbl;
+    }
+#endif
+
+    return &json_simd_scalar_vtbl;
+}
+
+
+const struct json_simd_vtbl_t *
+json_simd(void)
+{
+    static const struct json_simd_vtbl_t *vtbl;
+
+    if (!vtbl) {
+        vtbl = json_simd_resolve();
+    }
+
+    return vtbl;
+}
+
+
+const char *
+json_simd_skip_container(const struct json_simd_vtbl_t *simd, const char *p, const char *end, size_t depth)
+{
+    struct json_simd_index_state_t s = { 0, 0, 0 };
+    uint32_t pos[JSON_SIMD_BLOCK_SIZE + 1];
+    char block[JSON_SIMD_BLOCK_SIZE];
+
+    while (p < end) {
+        const char *b = p;
+        size_t n;
+
+        if (end - p >= JSON_SIMD_BLOCK_SIZE) {
+            n = simd->index(p, JSON_SIMD_BLOCK_SIZE, 0, pos, &s);
+        }
+        else {
+            memset(block, ' ', sizeof block);
+            memcpy(block, p, end - p);
+
+            n = simd->index(block, sizeof block, 0, pos, &s);
+            b = block;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            switch (b[pos[i]]) {
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (!--depth) {
+                    return p + pos[i] + 1;
+                }
+                break;
+            }
+        }
+
+        p += JSON_SIMD_BLOCK_SIZE;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef _JSON_SIMD_H_INCLUDED
+#define _JSON_SIMD_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define JSON_SIMD_BLOCK_SIZE    64
+
+
+struct json_simd_index_state_t {
+    uint64_t prev_escaped;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
+};
+
+
+struct json_simd_vtbl_t {
+    const char *name;
+    const char *(*skip_ws)(const char *p, const char *end);
+    const char *(*scan_string)(const char *p, const char *end);
+    size_t(*index)(const char *p, size_t len, uint32_t base, uint32_t *out,
+                   struct json_simd_index_state_t *state);
+    const char *(*scan_escape)(const char *p, const char *end);
+    int (*validate_utf8)(const char *p, const char *end);
+};
+
+
+const struct json_simd_vtbl_t *json_simd(void);
+
+/*
+ * p is outside any string, depth brackets deep; returns past the bracket
+ * that closes the outermost of them, NULL if there is none. the brackets
+ * are only counted, not matched.
+ */
+const char *json_simd_skip_container(const struct json_simd_vtbl_t *simd, const char *p, const char *end,
+                                     size_t depth);
+
+
+#endif //_JSON_SIMD_H_INCLUDED
@@ -0,0 +1,217 @@
+#include "json_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+
+static int
+json_fd_stream_fill(struct json_fd_stream_ctx_t *stream)
+{
+    if (stream->eof) {
+        return -1;
+    }
+
+    /* everything before the span in progress (or the read position) is spent */
+    char *keep = stream->mark ? stream->mark : stream->src;
+    size_t kept = stream->tail - keep;
+
+    if (keep != stream->buf) {
+        memmove(stream->buf, keep, kept);
+
+        stream->offset += keep - stream->buf;
+        stream->src -= keep - stream->buf;
+        stream->mark = stream->mark ? stream->buf : NULL;
+        stream->tail = stream->buf + kept;
+    }
+
+    if (kept == stream->size) {
+        char *buf = realloc(stream->buf, stream->size * 2);
+        if (!buf) {
+            stream->error = stream->eof = 1;
+            return -1;
+        }
+
+        stream->src = buf + (stream->src - stream->buf);
+        stream->mark = stream->mark ? buf : NULL;
+        stream->tail = buf + kept;
+        stream->buf = buf;
+        stream->size *= 2;
+    }
+
+    size_t room = stream->size - kept;
+    ssize_t n;
+
+    if (stream->fp) {
+        n = (ssize_t)fread(stream->tail, 1, room, stream->fp);
+
+        if (!n && ferror(stream->fp)) {
+            n = -1;
+        }
+    }
+    else {
+        while (((n = read(stream->fd, stream->tail, room)) < 0) && (EINTR == errno)) {
+        }
+    }
+
+    if (n <= 0) {
+        stream->error = (n < 0);
+        stream->eof = 1;
+        return -1;
+    }
+
+    stream->tail += n;
+
+    return 0;
+}
+
+
+static char
+json_fd_stream_peek(void *ctx)
+{
+    struct json_fd_stream_ctx_t *stream = ctx;
+
+    if ((stream->src >= stream->tail) && json_fd_stream_fill(stream)) {
+        return -1;
+    }
+
+    return *stream->src;
+}
+
+
+static char
+json_fd_stream_take(void *ctx)
+{
+    struct json_fd_stream_ctx_t *stream = ctx;
+
+    if ((stream->src >= stream->tail) && json_fd_stream_fill(stream)) {
+        return -1;
+    }
+
+    return *stream->src++;
+}
+
+
+static size_t
+json_fd_stream_tell(void *ctx)
+{
+    struct json_fd_stream_ctx_t *stream = ctx;
+    return stream->offset + (stream->src - stream->buf);
+}
+
+
+static char *
+json_fd_stream_put_begin(void *ctx)
+{
+    struct json_fd_stream_ctx_t *stream = ctx;
+
+    stream->put = 0;
+
+    return stream->mark = stream->src;
+}
+
+
+static void
+json_fd_stream_put(void *ctx, char c)
+{
+    struct json_fd_stream_ctx_t *stream = ctx;
+    ++stream->put;
+}
+
+
+static size_t
+json_fd_stream_put_end(void *ctx, char **begin)
+{
+    struct json_fd_stream_ctx_t *stream = ctx;
+
+    *begin = stream->mark;
+    stream->mark = NULL;
+
+    return stream->put;
+}
+
+
+static struct json_stream_vtbl_t
+json_fd_stream_vtbl = {
+    &json_fd_stream_peek,
+    &json_fd_stream_take,
+    &json_fd_stream_tell,
+    &json_fd_stream_put_begin,
+    &json_fd_stream_put,
+    NULL,
+    &json_fd_stream_put_end,
+    NULL,
+    JSON_STREAM_REUSES_BUFFER
+};
+
+
+int
+json_fd_stream_init(struct json_stream_t *stream, struct json_fd_stream_ctx_t *ctx, int fd, size_t size)
+{
+    ctx->fd = fd;
+    ctx->fp = NULL;
+
+    ctx->size = size ? size : JSON_FD_STREAM_BUFFER_SIZE;
+    ctx->buf = malloc(ctx->size);
+    if (!ctx->buf) {
+        return -1;
+    }
+
+    ctx->src = ctx->tail = ctx->buf;
+    ctx->mark = NULL;
+    ctx->put = 0;
+    ctx->offset = 0;
+    ctx->eof = ctx->error = 0;
+
+    stream->vtbl = &json_fd_stream_vtbl;
+    stream->ctx = ctx;
+
+    return 0;
+}
+
+
+int
+json_file_stream_init(struct json_stream_t *stream, struct json_fd_stream_ctx_t *ctx, FILE *fp, size_t size)
+{
+    if (json_fd_stream_init(stream, ctx, -1, size)) {
+        return -1;
+    }
+
+    ctx->fp = fp;
+
+    return 0;
+}
+
+
+void
+json_fd_stream_free(struct json_fd_stream_ctx_t *ctx)
+{
+    free(ctx->buf);
+    ctx->buf = ctx->src = ctx->tail = ctx->mark = NULL;
+}
+
+
+int
+json_parse_fd(struct json_parser_t *parser, int fd)
+{
+    struct json_fd_stream_ctx_t ctx;
+    struct json_stream_t stream;
+
+    if (json_fd_stream_init(&stream, &ctx, fd, 0)) {
+        return JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    if (!parser->a) {
+        json_parser_init(parser, parser->max_depth, NULL);
+    }
+
+    int r = json_parse_stream(parser, &stream);
+
+    if (r && ctx.error) {
+        r = JSON_PARSER_ERROR_TERMINATION;
+    }
+
+    json_fd_stream_free(&ctx);
+
+    return r;
+}
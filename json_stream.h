@@ -0,0 +1,50 @@
+#ifndef _JSON_STREAM_H_INCLUDED
+#define _JSON_STREAM_H_INCLUDED
+
+#include <stdio.h>
+#include "json_parser.h"
+
+
+#define JSON_FD_STREAM_BUFFER_SIZE  (64 * 1024)
+
+
+/*
+ * reads a file descriptor or FILE* through one reusable buffer. the bytes
+ * of a string or number in progress are kept across refills (moved to the
+ * front of the buffer, which only grows when a single token outgrows it),
+ * so memory stays bounded by the buffer size and the longest token.
+ */
+struct json_fd_stream_ctx_t {
+    int fd;
+    FILE *fp;
+
+    char *buf;
+    size_t size;
+
+    char *src;
+    char *tail;
+    char *mark;
+
+    size_t put;
+    size_t offset;
+
+    int eof;
+    int error;
+};
+
+
+/*
+ * either stream is JSON_STREAM_REUSES_BUFFER: json_parse_stream keeps copies
+ * of the strings of its tree. a reader's handler sees strings that are
+ * gone with the next read.
+ */
+int json_fd_stream_init(struct json_stream_t *stream, struct json_fd_stream_ctx_t *ctx, int fd, size_t size);
+
+int json_file_stream_init(struct json_stream_t *stream, struct json_fd_stream_ctx_t *ctx, FILE *fp, size_t size);
+
+void json_fd_stream_free(struct json_fd_stream_ctx_t *ctx);
+
+int json_parse_fd(struct json_parser_t *parser, int fd);
+
+
+#endif //_JSON_STREAM_H_INCLUDED
@@ -0,0 +1,142 @@
+#ifndef _JSON_UTF8_H_INCLUDED
+#define _JSON_UTF8_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* bytes one code point takes at most */
+#define JSON_UTF8_MAX               4
+
+#define JSON_UTF8_IS_HIGH(cp)       (((cp) & 0xFC00) == 0xD800)
+#define JSON_UTF8_IS_LOW(cp)        (((cp) & 0xFC00) == 0xDC00)
+
+#define JSON_UTF8_PAIR(high, low)   (0x10000 + (((uint32_t)(high) - 0xD800) << 10) + ((uint32_t)(low) - 0xDC00))
+
+
+static inline int
+json_hex_digit(int c)
+{
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+
+    c |= 0x20;
+
+    return ((c >= 'a') && (c <= 'f')) ? c - 'a' + 10 : -1;
+}
+
+
+/* the four hex digits at p, -1 if they are not */
+static inline int32_t
+json_hex4(const char *p)
+{
+    int32_t cp = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        int d = json_hex_digit((unsigned char)p[i]);
+
+        if (d < 0) {
+            return -1;
+        }
+
+        cp = (cp << 4) | d;
+    }
+
+    return cp;
+}
+
+
+static inline size_t
+json_utf8_size(uint32_t cp)
+{
+    return (cp < 0x80) ? 1 : (cp < 0x800) ? 2 : (cp < 0x10000) ? 3 : 4;
+}
+
+
+static inline size_t
+json_utf8_encode(uint32_t cp, char *out)
+{
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+
+/*
+ * the escape at p (past the backslash) of a string the parser took, as
+ * bytes into out; returns how many, *next is past the escape. a \u one
+ * that is not valid after all comes out as a plain 'u'.
+ */
+static inline size_t
+json_unescape(const char *p, char *out, const char **next)
+{
+    int32_t cp, low;
+
+    *next = p + 1;
+
+    switch (*p) {
+    case 'b':
+        *out = '\b';
+        return 1;
+    case 'f':
+        *out = '\f';
+        return 1;
+    case 'n':
+        *out = '\n';
+        return 1;
+    case 'r':
+        *out = '\r';
+        return 1;
+    case 't':
+        *out = '\t';
+        return 1;
+    case 'u':
+        if ((cp = json_hex4(p + 1)) < 0) {
+            break;
+        }
+
+        if (JSON_UTF8_IS_HIGH(cp)) {
+            if (('\\' != p[5]) || ('u' != p[6]) || ((low = json_hex4(p + 7)) < 0) || !JSON_UTF8_IS_LOW(low)) {
+                break;
+            }
+
+            cp = (int32_t)JSON_UTF8_PAIR(cp, low);
+            *next = p + 11;
+        }
+        else if (JSON_UTF8_IS_LOW(cp)) {
+            break;
+        }
+        else {
+            *next = p + 5;
+        }
+
+        return json_utf8_encode((uint32_t)cp, out);
+    }
+
+    *out = *p;
+    return 1;
+}
+
+
+#endif //_JSON_UTF8_H_INCLUDED
@@ -0,0 +1,1276 @@
+#include "json_writer.h"
+#include "json_utf8.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+static const char json_writer_digits[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+
+size_t
+json_u64toa(uint64_t v, char *buf)
+{
+    char tmp[20];
+    char *p = tmp + sizeof tmp;
+
+    while (v >= 100) {
+        const char *d = &json_writer_digits[(v % 100) * 2];
+        v /= 100;
+
+        *--p = d[1];
+        *--p = d[0];
+    }
+
+    if (v >= 10) {
+        const char *d = &json_writer_digits[v * 2];
+
+        *--p = d[1];
+        *--p = d[0];
+    }
+    else {
+        *--p = (char)('0' + v);
+    }
+
+    size_t n = tmp + sizeof tmp - p;
+    memcpy(buf, p, n);
+
+    return n;
+}
+
+
+size_t
+json_i64toa(int64_t v, char *buf)
+{
+    if (v < 0) {
+        *buf = '-';
+        return json_u64toa(0 - (uint64_t)v, buf + 1) + 1;
+    }
+
+    return json_u64toa((uint64_t)v, buf);
+}
+
+
+/*
+ * Grisu3 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers"), laid out after Milo Yip's dtoa: the shortest digits that
+ * read back to the same double, closest to it of those, for all but about
+ * half a percent of doubles, which Grisu3 tells apart and hands to an exact
+ * generation with big integers (Steele and White's free-format printing).
+ * either way the output is the shortest form that reads back the same.
+ */
+
+#define JSON_DIYFP_SIGNIFICAND_BITS     64
+#define JSON_DOUBLE_SIGNIFICAND_BITS    52
+#define JSON_DOUBLE_EXPONENT_BIAS       (0x3FF + JSON_DOUBLE_SIGNIFICAND_BITS)
+#define JSON_DOUBLE_HIDDEN_BIT          (UINT64_C(1) << JSON_DOUBLE_SIGNIFICAND_BITS)
+
+
+struct json_diyfp_t {
+    uint64_t f;
+    int e;
+};
+
+
+/* normalized 10^k for k = -348, -340, ..., 340 */
+static const uint64_t json_cached_powers_f[] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+    UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+    UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+    UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+    UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+    UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+    UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+    UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+    UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+    UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+    UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+    UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+    UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+    UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+    UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b),
+};
+
+static const int16_t json_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+
+static const uint64_t json_pow10[] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+    UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+    UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+    UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+    UINT64_C(1000000000000000), UINT64_C(10000000000000000), UINT64_C(100000000000000000),
+    UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)
+};
+
+
+static inline struct json_diyfp_t
+json_diyfp(uint64_t f, int e)
+{
+    struct json_diyfp_t r = { f, e };
+    return r;
+}
+
+
+static inline struct json_diyfp_t
+json_diyfp_mul(struct json_diyfp_t a, struct json_diyfp_t b)
+{
+    unsigned __int128 p = (unsigned __int128)a.f * b.f;
+    uint64_t h = (uint64_t)(p >> 64);
+
+    /* round the dropped half */
+    if ((uint64_t)p & (UINT64_C(1) << 63)) {
+        ++h;
+    }
+
+    return json_diyfp(h, a.e + b.e + 64);
+}
+
+
+static inline struct json_diyfp_t
+json_diyfp_normalize(struct json_diyfp_t v)
+{
+    int s = __builtin_clzll(v.f);
+    return json_diyfp(v.f << s, v.e - s);
+}
+
+
+/* the halfway points to the neighbours; the one below is closer at a power of two, but for the least normal */
+static void
+json_diyfp_boundaries(struct json_diyfp_t v, int lower_closer, struct json_diyfp_t *minus, struct json_diyfp_t *plus)
+{
+    struct json_diyfp_t pl = json_diyfp((v.f << 1) + 1, v.e - 1);
+
+    while (!(pl.f & (JSON_DOUBLE_HIDDEN_BIT << 1))) {
+        pl.f <<= 1;
+        pl.e--;
+    }
+
+    pl.f <<= JSON_DIYFP_SIGNIFICAND_BITS - JSON_DOUBLE_SIGNIFICAND_BITS - 2;
+    pl.e -= JSON_DIYFP_SIGNIFICAND_BITS - JSON_DOUBLE_SIGNIFICAND_BITS - 2;
+
+    struct json_diyfp_t mi = lower_closer
+        ? json_diyfp((v.f << 2) - 1, v.e - 2)
+        : json_diyfp((v.f << 1) - 1, v.e - 1);
+
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *plus = pl;
+    *minus = mi;
+}
+
+
+static inline struct json_diyfp_t
+json_cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+
+    if (dk - ik > 0.0) {
+        ++ik;
+    }
+
+    unsigned index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+
+    return json_diyfp(json_cached_powers_f[index], json_cached_powers_e[index]);
+}
+
+
+/*
+ * rest is what lies between the digits and too_high; walk the last digit
+ * down towards w while that keeps within the interval. 0 if the digits
+ * may not be the closest or may lie outside the interval: unit is the
+ * error of the scaled values, and within it the outcome is unknown.
+ */
+static inline int
+json_grisu_weed(char *buf, int len, uint64_t too_high_w, uint64_t unsafe, uint64_t rest, uint64_t ten_kappa,
+                uint64_t unit)
+{
+    const uint64_t small = too_high_w - unit;
+    const uint64_t big = too_high_w + unit;
+
+    while ((rest < small) && (unsafe - rest >= ten_kappa)
+           && ((rest + ten_kappa < small) || (small - rest >= rest + ten_kappa - small))) {
+
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+
+    /* for the far end of w's error one more step down might be closer: undecided */
+    if ((rest < big) && (unsafe - rest >= ten_kappa)
+        && ((rest + ten_kappa < big) || (big - rest > rest + ten_kappa - big))) {
+        return 0;
+    }
+
+    return (2 * unit <= rest) && (rest <= unsafe - 4 * unit);
+}
+
+
+static inline int
+json_count_digits(uint32_t n)
+{
+    int d = 1;
+
+    while ((d < 10) && (n >= json_pow10[d])) {
+        ++d;
+    }
+
+    return d;
+}
+
+
+/*
+ * the digits of too_high = high + unit up to where they fall in the unsafe
+ * interval, widened by unit each side from (low, high). 0 if the result
+ * cannot be proved shortest and closest.
+ */
+static int
+json_grisu_digits(struct json_diyfp_t low, struct json_diyfp_t w, struct json_diyfp_t high, char *buf, int *len,
+                  int *k)
+{
+    const struct json_diyfp_t one = json_diyfp(UINT64_C(1) << -w.e, w.e);
+
+    uint64_t unit = 1;
+    const uint64_t too_high = high.f + unit;
+    uint64_t unsafe = too_high - (low.f - unit);
+
+    uint32_t p1 = (uint32_t)(too_high >> -one.e);
+    uint64_t p2 = too_high & (one.f - 1);
+    int kappa = p1 ? json_count_digits(p1) : 0;
+
+    *len = 0;
+
+    while (kappa > 0) {
+        uint32_t d = p1 / (uint32_t)json_pow10[kappa - 1];
+        p1 %= (uint32_t)json_pow10[kappa - 1];
+
+        buf[(*len)++] = (char)('0' + d);
+        --kappa;
+
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest < unsafe) {
+            *k += kappa;
+            return json_grisu_weed(buf, *len, too_high - w.f, unsafe, rest, json_pow10[kappa] << -one.e, unit);
+        }
+    }
+
+    while (1) {
+        p2 *= 10;
+        unit *= 10;
+        unsafe *= 10;
+
+        char d = (char)(p2 >> -one.e);
+        if (d || *len) {
+            buf[(*len)++] = (char)('0' + d);
+        }
+
+        p2 &= one.f - 1;
+        --kappa;
+
+        if (p2 < unsafe) {
+            *k += kappa;
+            return *len && json_grisu_weed(buf, *len, (too_high - w.f) * unit, unsafe, p2, one.f, unit);
+        }
+    }
+}
+
+
+#define JSON_BIGNUM_WORDS               40
+
+/* enough for 2^1080 and 10^324 * 2^55, the most the exact digits come to */
+struct json_bignum_t {
+    uint32_t w[JSON_BIGNUM_WORDS];
+    int n;
+};
+
+
+static void
+json_bignum_set(struct json_bignum_t *b, uint64_t v)
+{
+    b->w[0] = (uint32_t)v;
+    b->w[1] = (uint32_t)(v >> 32);
+    b->n = (v >> 32) ? 2 : (v ? 1 : 0);
+}
+
+
+static void
+json_bignum_mul(struct json_bignum_t *b, uint32_t m)
+{
+    uint64_t c = 0;
+
+    for (int i = 0; i < b->n; ++i) {
+        c += (uint64_t)b->w[i] * m;
+        b->w[i] = (uint32_t)c;
+        c >>= 32;
+    }
+
+    if (c) {
+        b->w[b->n++] = (uint32_t)c;
+    }
+}
+
+
+static void
+json_bignum_pow10(struct json_bignum_t *b, int k)
+{
+    for (; k >= 9; k -= 9) {
+        json_bignum_mul(b, 1000000000);
+    }
+
+    if (k) {
+        json_bignum_mul(b, (uint32_t)json_pow10[k]);
+    }
+}
+
+
+static void
+json_bignum_shl(struct json_bignum_t *b, int s)
+{
+    const int words = s / 32;
+    const int bits = s % 32;
+
+    if (!b->n) {
+        return;
+    }
+
+    if (bits) {
+        uint32_t c = 0;
+
+        for (int i = 0; i < b->n; ++i) {
+            uint32_t x = b->w[i];
+            b->w[i] = (x << bits) | c;
+            c = x >> (32 - bits);
+        }
+
+        if (c) {
+            b->w[b->n++] = c;
+        }
+    }
+
+    if (words) {
+        memmove(b->w + words, b->w, b->n * sizeof b->w[0]);
+        memset(b->w, 0, words * sizeof b->w[0]);
+        b->n += words;
+    }
+}
+
+
+static void
+json_bignum_add(struct json_bignum_t *r, const struct json_bignum_t *a, const struct json_bignum_t *b)
+{
+    const int n = (a->n > b->n) ? a->n : b->n;
+    uint64_t c = 0;
+
+    for (int i = 0; i < n; ++i) {
+        c += (uint64_t)((i < a->n) ? a->w[i] : 0) + ((i < b->n) ? b->w[i] : 0);
+        r->w[i] = (uint32_t)c;
+        c >>= 32;
+    }
+
+    r->n = n;
+
+    if (c) {
+        r->w[r->n++] = (uint32_t)c;
+    }
+}
+
+
+/* a >= b */
+static void
+json_bignum_sub(struct json_bignum_t *a, const struct json_bignum_t *b)
+{
+    int64_t c = 0;
+
+    for (int i = 0; i < a->n; ++i) {
+        c += (int64_t)a->w[i] - ((i < b->n) ? b->w[i] : 0);
+        a->w[i] = (uint32_t)c;
+        c >>= 32;
+    }
+
+    while (a->n && !a->w[a->n - 1]) {
+        --a->n;
+    }
+}
+
+
+static int
+json_bignum_cmp(const struct json_bignum_t *a, const struct json_bignum_t *b)
+{
+    if (a->n != b->n) {
+        return (a->n < b->n) ? -1 : 1;
+    }
+
+    for (int i = a->n - 1; i >= 0; --i) {
+        if (a->w[i] != b->w[i]) {
+            return (a->w[i] < b->w[i]) ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * the shortest digits by Steele and White's free-format printing, exact:
+ * r / s is the value, m_minus / s and m_plus / s the distances to the
+ * halfway points to its neighbours, which read back to it too when the
+ * significand is even.
+ */
+static void
+json_dtoa_exact(struct json_diyfp_t v, int lower_closer, char *buf, int *len, int *k)
+{
+    struct json_bignum_t r, s, m_minus, m_plus, t;
+    const int even = !(v.f & 1);
+    int c;
+
+    if (v.e >= 0) {
+        json_bignum_set(&r, v.f);
+        json_bignum_shl(&r, v.e + 1 + lower_closer);
+        json_bignum_set(&s, 2 << lower_closer);
+        json_bignum_set(&m_minus, 1);
+        json_bignum_shl(&m_minus, v.e);
+        json_bignum_set(&m_plus, 1);
+        json_bignum_shl(&m_plus, v.e + lower_closer);
+    }
+    else {
+        json_bignum_set(&r, v.f << (1 + lower_closer));
+        json_bignum_set(&s, 1);
+        json_bignum_shl(&s, 1 + lower_closer - v.e);
+        json_bignum_set(&m_minus, 1);
+        json_bignum_set(&m_plus, 1 << lower_closer);
+    }
+
+    /* ceil(log10(v)), or one less */
+    double dk = (v.e + 63 - __builtin_clzll(v.f)) * 0.30102999566398114 - 1e-10;
+    int point = (int)dk;
+
+    if (dk - point > 0.0) {
+        ++point;
+    }
+
+    if (point >= 0) {
+        json_bignum_pow10(&s, point);
+    }
+    else {
+        json_bignum_pow10(&r, -point);
+        json_bignum_pow10(&m_minus, -point);
+        json_bignum_pow10(&m_plus, -point);
+    }
+
+    json_bignum_add(&t, &r, &m_plus);
+    c = json_bignum_cmp(&t, &s);
+
+    if (even ? (c >= 0) : (c > 0)) {
+        ++point;
+    }
+    else {
+        json_bignum_mul(&r, 10);
+        json_bignum_mul(&m_minus, 10);
+        json_bignum_mul(&m_plus, 10);
+    }
+
+    *len = 0;
+
+    while (1) {
+        int d = 0;
+
+        while (json_bignum_cmp(&r, &s) >= 0) {
+            json_bignum_sub(&r, &s);
+            ++d;
+        }
+
+        buf[(*len)++] = (char)('0' + d);
+
+        c = json_bignum_cmp(&r, &m_minus);
+        const int low = even ? (c <= 0) : (c < 0);
+
+        json_bignum_add(&t, &r, &m_plus);
+        c = json_bignum_cmp(&t, &s);
+        const int high = even ? (c >= 0) : (c > 0);
+
+        if (!low && !high) {
+            json_bignum_mul(&r, 10);
+            json_bignum_mul(&m_minus, 10);
+            json_bignum_mul(&m_plus, 10);
+            continue;
+        }
+
+        if (low && high) {
+            /* both read back: the closer, the even one on a tie */
+            json_bignum_add(&t, &r, &r);
+            c = json_bignum_cmp(&t, &s);
+
+            if ((c > 0) || (!c && (d & 1))) {
+                buf[*len - 1]++;
+            }
+        }
+        else if (high) {
+            buf[*len - 1]++;
+        }
+
+        break;
+    }
+
+    *k = point - *len;
+}
+
+
+static char *
+json_write_exponent(int k, char *buf)
+{
+    if (k < 0) {
+        *buf++ = '-';
+        k = -k;
+    }
+
+    if (k >= 100) {
+        *buf++ = (char)('0' + k / 100);
+        k %= 100;
+        memcpy(buf, &json_writer_digits[k * 2], 2);
+        buf += 2;
+    }
+    else if (k >= 10) {
+        memcpy(buf, &json_writer_digits[k * 2], 2);
+        buf += 2;
+    }
+    else {
+        *buf++ = (char)('0' + k);
+    }
+
+    return buf;
+}
+
+
+static char *
+json_prettify(char *buf, int len, int k)
+{
+    const int kk = len + k;
+
+    if ((0 <= k) && (kk <= 21)) {
+        /* 1234e7 -> 12340000000.0 */
+        memset(buf + len, '0', kk - len);
+        buf[kk] = '.';
+        buf[kk + 1] = '0';
+        return buf + kk + 2;
+    }
+
+    if ((0 < kk) && (kk <= 21)) {
+        /* 1234e-2 -> 12.34 */
+        memmove(buf + kk + 1, buf + kk, len - kk);
+        buf[kk] = '.';
+        return buf + len + 1;
+    }
+
+    if ((-6 < kk) && (kk <= 0)) {
+        /* 1234e-6 -> 0.001234 */
+        const int offset = 2 - kk;
+
+        memmove(buf + offset, buf, len);
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', offset - 2);
+        return buf + len + offset;
+    }
+
+    if (1 == len) {
+        /* 1e30 */
+        buf[1] = 'e';
+        return json_write_exponent(kk - 1, buf + 2);
+    }
+
+    /* 1234e30 -> 1.234e33 */
+    memmove(buf + 2, buf + 1, len - 1);
+    buf[1] = '.';
+    buf[len + 1] = 'e';
+    return json_write_exponent(kk - 1, buf + len + 2);
+}
+
+
+size_t
+json_dtoa(double d, char *buf)
+{
+    uint64_t u;
+    char *p = buf;
+
+    memcpy(&u, &d, sizeof u);
+
+    if (u >> 63) {
+        *p++ = '-';
+    }
+
+    u &= ~(UINT64_C(1) << 63);
+
+    if (!u) {
+        memcpy(p, "0.0", 3);
+        return p + 3 - buf;
+    }
+
+    int biased_e = (int)(u >> JSON_DOUBLE_SIGNIFICAND_BITS);
+    uint64_t significand = u & (JSON_DOUBLE_HIDDEN_BIT - 1);
+
+    struct json_diyfp_t v = biased_e
+        ? json_diyfp(significand | JSON_DOUBLE_HIDDEN_BIT, biased_e - JSON_DOUBLE_EXPONENT_BIAS)
+        : json_diyfp(significand, 1 - JSON_DOUBLE_EXPONENT_BIAS);
+
+    const int lower_closer = !significand && (biased_e > 1);
+
+    struct json_diyfp_t w_m, w_p;
+    json_diyfp_boundaries(v, lower_closer, &w_m, &w_p);
+
+    int k;
+    const struct json_diyfp_t c_mk = json_cached_power(w_p.e, &k);
+    const struct json_diyfp_t w = json_diyfp_mul(json_diyfp_normalize(v), c_mk);
+
+    int len;
+    if (!json_grisu_digits(json_diyfp_mul(w_m, c_mk), w, json_diyfp_mul(w_p, c_mk), p, &len, &k)) {
+        json_dtoa_exact(v, lower_closer, p, &len, &k);
+    }
+
+    return json_prettify(p, len, k) - buf;
+}
+
+
+static int
+json_writer_drain(struct json_writer_t *w, const char *data, size_t len)
+{
+    struct json_stream_t *stream = w->stream;
+
+    if (w->error || !len) {
+        return w->error;
+    }
+
+    if (stream->vtbl->write) {
+        if (stream->vtbl->write(stream->ctx, data, len) != len) {
+            w->error = -1;
+        }
+    }
+    else {
+        for (size_t i = 0; i < len; ++i) {
+            stream->vtbl->put(stream->ctx, data[i]);
+        }
+    }
+
+    return w->error;
+}
+
+
+/* room for at least n (<= JSON_WRITER_BUFFER_SIZE) more bytes */
+static inline char *
+json_writer_reserve(struct json_writer_t *w, size_t n)
+{
+    if (n > JSON_WRITER_BUFFER_SIZE - w->len) {
+        json_writer_drain(w, w->buf, w->len);
+        w->len = 0;
+    }
+
+    return w->buf + w->len;
+}
+
+
+static inline void
+json_writer_append(struct json_writer_t *w, const char *data, size_t len)
+{
+    if (len > JSON_WRITER_BUFFER_SIZE - w->len) {
+        json_writer_drain(w, w->buf, w->len);
+        w->len = 0;
+
+        if (len >= JSON_WRITER_BUFFER_SIZE) {
+            json_writer_drain(w, data, len);
+            return;
+        }
+    }
+
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+
+static inline void
+json_writer_putc(struct json_writer_t *w, char c)
+{
+    *json_writer_reserve(w, 1) = c;
+    ++w->len;
+}
+
+
+static void
+json_writer_newline(struct json_writer_t *w)
+{
+    static const char spaces[] = "                                                                ";
+    size_t n = w->depth * JSON_WRITER_INDENT;
+
+    json_writer_putc(w, '\n');
+
+    while (n) {
+        size_t k = (n < sizeof spaces - 1) ? n : sizeof spaces - 1;
+
+        json_writer_append(w, spaces, k);
+        n -= k;
+    }
+}
+
+
+/* separator and indentation owed before the next value or key */
+static void
+json_writer_prefix(struct json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+
+    if (!w->first) {
+        json_writer_putc(w, w->depth ? ',' : '\n');
+    }
+
+    if (w->depth && (w->flags & JSON_WRITER_PRETTY)) {
+        json_writer_newline(w);
+    }
+
+    w->first = 0;
+}
+
+
+static void
+json_writer_string(struct json_writer_t *w, const char *p, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    json_writer_putc(w, '"');
+
+    /*
+     * p is a string as the parser hands it out: source text with escapes
+     * left in place, len counting decoded bytes. escapes are copied as is;
+     * bare quotes and control bytes (hand-built values) are escaped here.
+     */
+    while (len) {
+        const char *q = w->simd->scan_escape(p, p + len);
+
+        json_writer_append(w, p, q - p);
+        len -= q - p;
+        p = q;
+
+        if (!len) {
+            break;
+        }
+
+        if ('\\' == *p) {
+            char buf[JSON_UTF8_MAX];
+            const char *next;
+
+            /* a \u escape counts as the bytes of its code point */
+            size_t n = json_unescape(p + 1, buf, &next);
+
+            json_writer_append(w, p, next - p);
+            len -= n;
+            p = next;
+
+            continue;
+        }
+        else {
+            char *out = json_writer_reserve(w, 6);
+            unsigned char c = (unsigned char)*p++;
+
+            switch (c) {
+            case '"':
+                memcpy(out, "\\\"", 2);
+                w->len += 2;
+                break;
+            case '\b':
+                memcpy(out, "\\b", 2);
+                w->len += 2;
+                break;
+            case '\f':
+                memcpy(out, "\\f", 2);
+                w->len += 2;
+                break;
+            case '\n':
+                memcpy(out, "\\n", 2);
+                w->len += 2;
+                break;
+            case '\r':
+                memcpy(out, "\\r", 2);
+                w->len += 2;
+                break;
+            case '\t':
+                memcpy(out, "\\t", 2);
+                w->len += 2;
+                break;
+            default:
+                memcpy(out, "\\u00", 4);
+                out[4] = hex[c >> 4];
+                out[5] = hex[c & 0xF];
+                w->len += 6;
+                break;
+            }
+        }
+
+        --len;
+    }
+
+    json_writer_putc(w, '"');
+}
+
+
+void
+json_writer_init(struct json_writer_t *w, struct json_stream_t *stream, int flags)
+{
+    w->stream = stream;
+    w->simd = json_simd();
+    w->flags = flags;
+    w->error = 0;
+    w->depth = 0;
+    w->first = 1;
+    w->after_key = 0;
+    w->len = 0;
+}
+
+
+int
+json_writer_flush(struct json_writer_t *w)
+{
+    json_writer_drain(w, w->buf, w->len);
+    w->len = 0;
+
+    if (!w->error && w->stream->vtbl->flush) {
+        w->stream->vtbl->flush(w->stream->ctx);
+    }
+
+    return w->error;
+}
+
+
+int
+json_writer_null(struct json_writer_t *w)
+{
+    json_writer_prefix(w);
+    json_writer_append(w, "null", 4);
+
+    return w->error;
+}
+
+
+int
+json_writer_bool(struct json_writer_t *w, int b)
+{
+    json_writer_prefix(w);
+
+    if (b) {
+        json_writer_append(w, "true", 4);
+    }
+    else {
+        json_writer_append(w, "false", 5);
+    }
+
+    return w->error;
+}
+
+
+int
+json_writer_int64(struct json_writer_t *w, int64_t i)
+{
+    json_writer_prefix(w);
+    w->len += json_i64toa(i, json_writer_reserve(w, 20));
+
+    return w->error;
+}
+
+
+int
+json_writer_uint64(struct json_writer_t *w, uint64_t i)
+{
+    json_writer_prefix(w);
+    w->len += json_u64toa(i, json_writer_reserve(w, 20));
+
+    return w->error;
+}
+
+
+int
+json_writer_double(struct json_writer_t *w, double d)
+{
+    json_writer_prefix(w);
+
+    /* not representable in JSON */
+    if ((d - d) != (d - d)) {
+        json_writer_append(w, "null", 4);
+        return w->error;
+    }
+
+    w->len += json_dtoa(d, json_writer_reserve(w, JSON_DTOA_BUFFER_SIZE));
+
+    return w->error;
+}
+
+
+int
+json_writer_key(struct json_writer_t *w, const char *str, size_t len)
+{
+    json_writer_prefix(w);
+    json_writer_string(w, str, len);
+
+    if (w->flags & JSON_WRITER_PRETTY) {
+        json_writer_append(w, ": ", 2);
+    }
+    else {
+        json_writer_putc(w, ':');
+    }
+
+    w->after_key = 1;
+
+    return w->error;
+}
+
+
+int
+json_writer_str(struct json_writer_t *w, const char *str, size_t len)
+{
+    json_writer_prefix(w);
+    json_writer_string(w, str, len);
+
+    return w->error;
+}
+
+
+static int
+json_writer_start(struct json_writer_t *w, char c)
+{
+    json_writer_prefix(w);
+    json_writer_putc(w, c);
+
+    ++w->depth;
+    w->first = 1;
+
+    return w->error;
+}
+
+
+static int
+json_writer_end(struct json_writer_t *w, char c)
+{
+    assert(w->depth);
+    --w->depth;
+
+    if (!w->first && (w->flags & JSON_WRITER_PRETTY)) {
+        json_writer_newline(w);
+    }
+
+    json_writer_putc(w, c);
+    w->first = 0;
+
+    return w->error;
+}
+
+
+int
+json_writer_start_object(struct json_writer_t *w)
+{
+    return json_writer_start(w, '{');
+}
+
+
+int
+json_writer_end_object(struct json_writer_t *w)
+{
+    return json_writer_end(w, '}');
+}
+
+
+int
+json_writer_start_array(struct json_writer_t *w)
+{
+    return json_writer_start(w, '[');
+}
+
+
+int
+json_writer_end_array(struct json_writer_t *w)
+{
+    return json_writer_end(w, ']');
+}
+
+
+int
+json_writer_value(struct json_writer_t *w, const struct json_value_t *v)
+{
+    size_t i;
+
+    switch (v->type) {
+    case JSON_VALUE_TYPE_NULL:
+        return json_writer_null(w);
+
+    case JSON_VALUE_TYPE_BOOL:
+        return json_writer_bool(w, v->b);
+
+    case JSON_VALUE_TYPE_INT:
+        return json_writer_int64(w, v->i);
+
+    case JSON_VALUE_TYPE_INT64:
+        return json_writer_int64(w, v->i64);
+
+    case JSON_VALUE_TYPE_UINT64:
+        return json_writer_uint64(w, v->u64);
+
+    case JSON_VALUE_TYPE_DOUBLE:
+        return json_writer_double(w, v->d);
+
+    case JSON_VALUE_TYPE_STRING:
+        return json_writer_str(w, v->str.data, v->str.len);
+
+    case JSON_VALUE_TYPE_OBJECT:
+        json_writer_start_object(w);
+
+        for (i = 0; (i < v->obj.size) && !w->error; ++i) {
+            json_writer_key(w, v->obj.elts[i].key.data, v->obj.elts[i].key.len);
+            json_writer_value(w, &v->obj.elts[i].val);
+        }
+
+        return json_writer_end_object(w);
+
+    case JSON_VALUE_TYPE_ARRAY:
+        json_writer_start_array(w);
+
+        for (i = 0; (i < v->arr.size) && !w->error; ++i) {
+            json_writer_value(w, &v->arr.elts[i]);
+        }
+
+        return json_writer_end_array(w);
+
+    default:
+        return w->error = -1;
+    }
+}
+
+
+int
+json_write(struct json_stream_t *stream, const struct json_value_t *v, int flags)
+{
+    struct json_writer_t w;
+    json_writer_init(&w, stream, flags);
+
+    if (json_writer_value(&w, v)) {
+        return -1;
+    }
+
+    return json_writer_flush(&w);
+}
+
+
+static int
+json_writer_on_null(void *ctx)
+{
+    return json_writer_null(ctx);
+}
+
+
+static int
+json_writer_on_bool(void *ctx, int b)
+{
+    return json_writer_bool(ctx, b);
+}
+
+
+static int
+json_writer_on_int(void *ctx, int i)
+{
+    return json_writer_int64(ctx, i);
+}
+
+
+static int
+json_writer_on_uint(void *ctx, unsigned int i)
+{
+    return json_writer_uint64(ctx, i);
+}
+
+
+static int
+json_writer_on_int64(void *ctx, int64_t i)
+{
+    return json_writer_int64(ctx, i);
+}
+
+
+static int
+json_writer_on_uint64(void *ctx, uint64_t i)
+{
+    return json_writer_uint64(ctx, i);
+}
+
+
+static int
+json_writer_on_double(void *ctx, double d)
+{
+    return json_writer_double(ctx, d);
+}
+
+
+static int
+json_writer_on_key(void *ctx, const char *str, size_t len)
+{
+    return json_writer_key(ctx, str, len);
+}
+
+
+static int
+json_writer_on_string(void *ctx, const char *str, size_t len)
+{
+    return json_writer_str(ctx, str, len);
+}
+
+
+static int
+json_writer_on_start_object(void *ctx)
+{
+    return json_writer_start_object(ctx);
+}
+
+
+static int
+json_writer_on_end_object(void *ctx, size_t count)
+{
+    return json_writer_end_object(ctx);
+}
+
+
+static int
+json_writer_on_start_array(void *ctx)
+{
+    return json_writer_start_array(ctx);
+}
+
+
+static int
+json_writer_on_end_array(void *ctx, size_t count)
+{
+    return json_writer_end_array(ctx);
+}
+
+
+static struct json_parser_handler_vtbl_t
+json_writer_handler_vtbl = {
+    &json_writer_on_null,
+    &json_writer_on_bool,
+    &json_writer_on_int,
+    &json_writer_on_uint,
+    &json_writer_on_int64,
+    &json_writer_on_uint64,
+    &json_writer_on_double,
+    &json_writer_on_key,
+    &json_writer_on_string,
+    &json_writer_on_start_object,
+    &json_writer_on_end_object,
+    &json_writer_on_start_array,
+    &json_writer_on_end_array
+};
+
+
+void
+json_writer_handler(struct json_parser_handler_t *handler, struct json_writer_t *w)
+{
+    handler->vtbl = &json_writer_handler_vtbl;
+    handler->ctx = w;
+}
+
+
+static size_t
+json_buf_stream_tell(void *ctx)
+{
+    struct json_buf_stream_ctx_t *stream = ctx;
+    return stream->len;
+}
+
+
+static size_t
+json_buf_stream_write(void *ctx, const char *data, size_t len)
+{
+    struct json_buf_stream_ctx_t *stream = ctx;
+
+    if (len > stream->capacity - stream->len) {
+        size_t capacity = stream->capacity ? stream->capacity : JSON_WRITER_BUFFER_SIZE;
+
+        while (len > capacity - stream->len) {
+            capacity *= 2;
+        }
+
+        char *p = realloc(stream->data, capacity);
+        if (!p) {
+            return 0;
+        }
+
+        stream->data = p;
+        stream->capacity = capacity;
+    }
+
+    memcpy(stream->data + stream->len, data, len);
+    stream->len += len;
+
+    return len;
+}
+
+
+static void
+json_buf_stream_put(void *ctx, char c)
+{
+    json_buf_stream_write(ctx, &c, 1);
+}
+
+
+static struct json_stream_vtbl_t
+json_buf_stream_vtbl = {
+    NULL,
+    NULL,
+    &json_buf_stream_tell,
+    NULL,
+    &json_buf_stream_put,
+    NULL,
+    NULL,
+    &json_buf_stream_write
+};
+
+
+void
+json_buf_stream_init(struct json_stream_t *stream, struct json_buf_stream_ctx_t *ctx)
+{
+    ctx->data = NULL;
+    ctx->len = ctx->capacity = 0;
+
+    stream->vtbl = &json_buf_stream_vtbl;
+    stream->ctx = ctx;
+}
@@ -0,0 +1,87 @@
+#ifndef _JSON_WRITER_H_INCLUDED
+#define _JSON_WRITER_H_INCLUDED
+
+#include <stdint.h>
+#include "json_parser.h"
+#include "json_simd.h"
+
+
+#define JSON_WRITER_BUFFER_SIZE     4096
+#define JSON_WRITER_INDENT          4
+
+#define JSON_WRITER_PRETTY          0x1
+
+#define JSON_DTOA_BUFFER_SIZE       32
+
+
+/*
+ * serializer over a json_stream_t. output is staged in an internal buffer
+ * and handed to the stream's write (or put, byte by byte) in bulk.
+ * strings are taken in the form the parser produces: escapes left in the
+ * source text, length counting decoded bytes.
+ */
+struct json_writer_t {
+    struct json_stream_t *stream;
+    const struct json_simd_vtbl_t *simd;
+
+    int flags;
+    int error;
+
+    size_t depth;
+    int first;
+    int after_key;
+
+    size_t len;
+    char buf[JSON_WRITER_BUFFER_SIZE];
+};
+
+
+struct json_buf_stream_ctx_t {
+    char *data;
+    size_t len;
+    size_t capacity;
+};
+
+
+void json_writer_init(struct json_writer_t *w, struct json_stream_t *stream, int flags);
+
+int json_writer_flush(struct json_writer_t *w);
+
+int json_writer_null(struct json_writer_t *w);
+
+int json_writer_bool(struct json_writer_t *w, int b);
+
+int json_writer_int64(struct json_writer_t *w, int64_t i);
+
+int json_writer_uint64(struct json_writer_t *w, uint64_t i);
+
+int json_writer_double(struct json_writer_t *w, double d);
+
+int json_writer_key(struct json_writer_t *w, const char *str, size_t len);
+
+int json_writer_str(struct json_writer_t *w, const char *str, size_t len);
+
+int json_writer_start_object(struct json_writer_t *w);
+
+int json_writer_end_object(struct json_writer_t *w);
+
+int json_writer_start_array(struct json_writer_t *w);
+
+int json_writer_end_array(struct json_writer_t *w);
+
+int json_writer_value(struct json_writer_t *w, const struct json_value_t *v);
+
+void json_writer_handler(struct json_parser_handler_t *handler, struct json_writer_t *w);
+
+int json_write(struct json_stream_t *stream, const struct json_value_t *v, int flags);
+
+size_t json_dtoa(double d, char *buf);
+
+size_t json_i64toa(int64_t v, char *buf);
+
+size_t json_u64toa(uint64_t v, char *buf);
+
+void json_buf_stream_init(struct json_stream_t *stream, struct json_buf_stream_ctx_t *ctx);
+
+
+#endif //_JSON_WRITER_H_INCLUDED